@@ -90,6 +90,25 @@ protected:
   virtual void
   solve() override;
 
+  /**
+   * 块系统矩阵的带宽，按所有块拼成的全局编号计算。
+   */
+  virtual types::global_dof_index
+  matrix_bandwidth() const override;
+
+  virtual void
+  print_matrix_statistics() override;
+
+  virtual void
+  diagnostics(const unsigned int cycle) override;
+
+  /**
+   * 分量之间的耦合，用来构造稀疏模式。默认所有分量都相互耦合；
+   * 派生类可以去掉局部矩阵中总是为零的块，以节省内存和矩阵-向量乘积的时间。
+   */
+  virtual Table<2, DoFTools::Coupling>
+  coupling_table() const;
+
   const std::vector<std::string> component_names;
 
   /**
@@ -22,33 +22,50 @@
 #ifndef base_problem_include_file
 #define base_problem_include_file
 
+#include "cached_function.h"
+
+#include <deal.II/base/aligned_vector.h> // 批量装配中VectorizedArray的缓冲区
 #include <deal.II/base/function.h> // 提供了一些零函数、常函数
 #include <deal.II/base/function_parser.h> // 函数转化为代码，FunctionParser
+#include <deal.II/base/mpi_remote_point_evaluation.h> // 诊断中的点值
 #include <deal.II/base/multithread_info.h>
 #include <deal.II/base/parameter_acceptor.h> // 参数接收，以及输送到prm
 #include <deal.II/base/parsed_convergence_table.h> // 结果分析整理成table
 #include <deal.II/base/quadrature_lib.h>           // 不同的积分点策略
 #include <deal.II/base/thread_management.h>
 #include <deal.II/base/timer.h> // 计时
+#include <deal.II/base/vectorization.h> // 批量装配中的SIMD
 #include <deal.II/base/work_stream.h>
 
+#include <deal.II/distributed/cell_weights.h> // hp模式下按自由度数进行负载平衡
 #include <deal.II/distributed/grid_refinement.h> // 分布式网格加密策略
 #include <deal.II/distributed/tria.h>            // 分布式网格划分策略
 
 #include <deal.II/dofs/dof_handler.h> // 自由度分配管理策略
+#include <deal.II/dofs/dof_renumbering.h> // 自由度重新编号，提高数据局部性
 #include <deal.II/dofs/dof_tools.h> //自由度相关的工具，比如make_sparsity_pattern
 
 #include <deal.II/fe/fe_q.h> // this->degree
+#include <deal.II/fe/fe_series.h> // hp模式下的光滑性估计
+#include <deal.II/fe/fe_system.h> // 对偶问题的高阶有限元
 #include <deal.II/fe/fe_tools.h>
 #include <deal.II/fe/fe_values.h> // 有限元配置，积分点，mapping的一次大装配
 #include <deal.II/fe/fe_values_extractors.h> // 允许你将单一的形状函数解释为张量、标量等类型的对象
+#include <deal.II/fe/mapping_q_cache.h> // 缓存每个单元的映射支撑点
 #include <deal.II/fe/mapping_q_generic.h> // 导数矩阵，插值矩阵等，利用映射关系
 
 #include <deal.II/grid/grid_generator.h> // 基本的形状网格，cube等
+#include <deal.II/grid/grid_in.h> // 从网格文件中读入粗网格
 #include <deal.II/grid/grid_out.h>
 #include <deal.II/grid/grid_refinement.h>
+#include <deal.II/grid/grid_tools.h> // get_coarse_mesh_description
 #include <deal.II/grid/tria.h> // 网格划分
 
+#include <deal.II/hp/fe_collection.h> // hp模式下的有限元集合
+#include <deal.II/hp/fe_values.h>     // 诊断中的边界积分
+#include <deal.II/hp/q_collection.h>  // hp模式下的积分公式集合
+#include <deal.II/hp/refinement.h>    // h和p加密之间的选择
+
 #include <deal.II/lac/affine_constraints.h> // 此处用于处理hanging nodes节点的不连续问题
 #include <deal.II/lac/dynamic_sparsity_pattern.h> // 动态稀疏矩阵存储，避免内存过大
 #include <deal.II/lac/full_matrix.h> // 矩阵的一些相关操作，例如求转置等
@@ -57,21 +74,27 @@
 #include <deal.II/lac/solver_cg.h>    // CG算法求解方程
 #include <deal.II/lac/sparse_direct.h>
 #include <deal.II/lac/sparse_matrix.h> // 稀疏矩阵相关算法
+#include <deal.II/lac/sparsity_pattern.h>
 #include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_solver.h> // Amesos 直接求解器
 #include <deal.II/lac/vector.h> // 向量相关
 
 #include <deal.II/meshworker/copy_data.h>
 #include <deal.II/meshworker/copy_data.h> // 拷贝相关的数据操作
+#include <deal.II/meshworker/mesh_loop.h> // DG装配中的面积分
 #include <deal.II/meshworker/scratch_data.h>
 #include <deal.II/meshworker/scratch_data.h> // 消耗cpu的计算操作
 
 #include <deal.II/numerics/data_out.h> // 数据后处理相关操作
 #include <deal.II/numerics/error_estimator.h>
 #include <deal.II/numerics/matrix_tools.h> // 处理矩阵的相关类库
+#include <deal.II/numerics/smoothness_estimator.h> // Legendre/Fourier系数衰减
 #include <deal.II/numerics/vector_tools.h> // 处理向量的相关类库
+#include <deal.II/numerics/vector_tools_evaluate.h> // VectorTools::point_values
 
 #include <boost/signals2.hpp> // 插眼
 
+#include <atomic>
 #include <fstream>  // 文件流，跟文件处理相关的操作
 #include <iostream> // 字符串相关操作
 
@@ -95,6 +118,21 @@ namespace LA
 } // namespace LA
 
 
+#ifdef DEBUG
+/**
+ * 返回当前线程到目前为止堆分配次数的函数。库本身不替换operator new，
+ * 默认为空；测试程序可以替换全局的operator new并在需要统计时设置它。
+ */
+extern std::size_t (*thread_local_allocation_counter)();
+
+/**
+ * Debug模式下当前线程的堆分配次数，用来检查装配中的堆分配。
+ * 没有设置`thread_local_allocation_counter`时总是返回零。
+ */
+std::size_t
+n_thread_local_allocations();
+#endif
+
 // 声明测试类
 template <typename Integral>
 class BaseProblemTester;
@@ -131,18 +169,40 @@ public:
   /**
    * 问题的主要切入点。
    */
-  void
+  virtual void
   run();
 
+  /**
+   * 在同一个进程中依次运行一组参数配置，并在最后输出所有运行的汇总表。
+   *
+   * 扫描文件的每一行形如`Poisson<2>/Problem constants = k:1 | k:2`，
+   * 即用`/`分隔的参数路径和用`|`分隔的取值。默认对所有行取笛卡尔积；
+   * 如果文件中有一行`mode = zip`，则按位置一一对应地组合各行的取值。
+   * 如果一次运行没有改变网格相关的参数，并且上一次运行没有加密网格，则重复使用已有的网格。
+   * 如果此外只改变了外力项、Neumann边界条件、精确解或输出文件名，还保留上一次运行的
+   * 自由度、约束、矩阵和它的分解，只重新组装右手边。
+   *
+   * @param sweep_filename 扫描文件的文件名。
+   */
+  void
+  run_ensemble(const std::string &sweep_filename);
+
 
   /**
-   * 用给定的文件初始化内部参数。
+   * 用给定的文件初始化内部参数，然后在任何并行计算之前配置线程。
    *
    * @param filename 指的是参数的文件名.
    */
   void
   initialize(const std::string &filename);
 
+  /**
+   * 用共享内存的子通信器找出同一个节点上继承了同一组可用核（cpuset）的进程，
+   * 由它们平分这些核来设置每个进程的线程数，按需要绑定到核上，并输出所选的布局。
+   */
+  void
+  configure_threads();
+
 
   /**
    * 解析一个字符串，好像它是一个参数文件，并相应地设置参数。主要用在测试中，方便测试过程。
@@ -152,6 +212,16 @@ public:
   void
   parse_string(const std::string &par); // 为了直接从test中嵌入代码,进行相关测试
 
+  /**
+   * 读入所有参数。误差范数只由"Error norms"决定，否则error_from_exact()会添加
+   * 同名的列；旧的参数文件在顶层的"Error table"中列出的范数被并入`error_norms`，
+   * 然后该项恢复为空。
+   *
+   * @param prm 已经进入本类所在小节的参数处理器。
+   */
+  virtual void
+  parse_parameters(ParameterHandler &prm) override;
+
   /**
    * 默认的CopyData对象，在WorkStream类中使用。
    */
@@ -161,6 +231,28 @@ public:
    */
   using ScratchData = MeshWorker::ScratchData<dim>;
 
+  /**
+   * DG装配中一个内部面上的局部矩阵，行和列是两侧单元的所有自由度。
+   */
+  struct FaceCopyData
+  {
+    FullMatrix<double>                   matrix;
+    std::vector<types::global_dof_index> joint_dof_indices;
+  };
+
+  /**
+   * DG装配中一个单元的数据：单元和边界面的贡献放在`cell`中，内部面的贡献放在`faces`中。
+   */
+  struct DGCopyData
+  {
+    DGCopyData(const unsigned int dofs_per_cell)
+      : cell(dofs_per_cell)
+    {}
+
+    CopyData                  cell;
+    std::vector<FaceCopyData> faces;
+  };
+
 protected:
   /**
    * 在`cell`上组装本地系统矩阵，对FEValues和其他昂贵的抓取对象使用`scratch`，并将结果存储在`copy`对象中。
@@ -185,6 +277,50 @@ protected:
   virtual void
   copy_one_cell(const CopyData &copy);
 
+  /**
+   * DG模式下，在Dirichlet边界面`face_no`上把弱形式的边界条件加到`copy`中。
+   *
+   * @param cell 面所在的单元。
+   * @param face_no 面在单元中的编号。
+   * @param scratch Scratch object.
+   * @param copy 单元的本地数据，已经包含了单元上的贡献。
+   */
+  virtual void
+  assemble_boundary_face_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    const unsigned int                                    face_no,
+    ScratchData &                                         scratch,
+    CopyData &                                            copy);
+
+  /**
+   * DG模式下，在两个单元之间的内部面上组装面项。参数的含义与
+   * MeshWorker::mesh_loop()中的face_worker相同。
+   */
+  virtual void
+  assemble_interior_face(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    const unsigned int                                    face_no,
+    const unsigned int                                    subface_no,
+    const typename DoFHandler<dim>::active_cell_iterator &neighbor,
+    const unsigned int                                    neighbor_face_no,
+    const unsigned int                                    neighbor_subface_no,
+    ScratchData &                                         scratch,
+    FaceCopyData &                                        copy);
+
+  /**
+   * 用MeshWorker::mesh_loop()装配单元、边界面和内部面。每个内部面只装配一次，
+   * 包括与其他进程的单元之间的面。
+   */
+  void
+  assemble_system_dg();
+
+  /**
+   * 有限元空间是否是不连续的，例如FE_DGQ。所有的基本单元都不连续时才返回
+   * true。这时Dirichlet边界条件由面项弱施加，稀疏模式包含相邻单元之间的耦合。
+   */
+  bool
+  is_dg() const;
+
 
   /**
    * 生成参数文件中指定的初始网格。
@@ -192,6 +328,40 @@ protected:
   void
   make_grid();
 
+  /**
+   * 在第0号进程上用GridIn读入`grid_input_file`，然后把粗网格的描述广播给所有进程。
+   * 这样每个进程不必各自解析网格文件。
+   */
+  void
+  read_grid();
+
+  /**
+   * 预加密后网格的缓存键，由所有与网格有关的参数和网格文件内容的哈希值组成。
+   */
+  std::string
+  mesh_cache_key() const;
+
+  /**
+   * 预加密后网格的缓存文件名，由缓存键的FNV-1a哈希值决定。
+   * 没有设置`mesh_cache_directory`时返回空字符串。
+   *
+   * @param key mesh_cache_key()返回的缓存键。
+   */
+  std::string
+  mesh_cache_filename(const std::string &key) const;
+
+  /**
+   * 在已有的网格上执行所有的求解-估计-标记-细化循环，并输出误差表格。
+   */
+  void
+  run_refinement_cycles();
+
+  /**
+   * 输出从run()开始到第一次求解结束的时间，以及各个进程占用内存的最小、平均和最大值。
+   */
+  void
+  print_startup_statistics() const;
+
   /**
    * 求解全局系统。
    */
@@ -205,6 +375,65 @@ protected:
   virtual void
   estimate();
 
+  /**
+   * 在`dofs`描述的空间中组装目标泛函 $J$ 对应的对偶右端项
+   * $J(\varphi_i)$，并用`dual_constraints`消去受约束的自由度。
+   *
+   * @param dofs 对偶右端项所在的空间。
+   * @param discrete_solution `dofs`上带有本地相关自由度的离散解，
+   * 用来计算 $J(u_h)$。
+   * @param dual_rhs 对偶右端项。
+   * @param dual_constraints 对偶问题的约束。
+   * @return 离散解和精确解上的泛函值 $(J(u_h), J(u))$。
+   */
+  std::pair<double, double>
+  assemble_goal_functional(
+    const DoFHandler<dim> &          dofs,
+    const LA::MPI::Vector &          discrete_solution,
+    LA::MPI::Vector &                dual_rhs,
+    const AffineConstraints<double> &dual_constraints) const;
+
+  /**
+   * 在同一个网格上用高一阶的FE_Q求解对偶问题 $A^T z = J$，并把
+   * $\|z - I_h z\|_K$ 存入`dual_weights`，其中 $I_h$ 是到原始空间的插值。
+   * 对偶矩阵用assemble_system_one_cell()组装，所以与原始问题的算子相同。
+   */
+  void
+  compute_dual_weights();
+
+  /**
+   * 在`fe_values`的积分点上计算强形式的残差 $f + \nabla\cdot\sigma(u_h)$
+   * 的各个分量，供"residual"和"dwr"估计器使用。默认是Laplace算子的残差
+   * $f + \Delta u_h$，算子不同的派生类需要重载它。
+   *
+   * @param fe_values 已经在当前单元上初始化，包含值、梯度和Hessian。
+   * @param local_dof_values 离散解在当前单元上的自由度值。
+   * @param residuals 每个积分点上各个分量的残差。
+   */
+  virtual void
+  compute_strong_residual(const FEValues<dim> &        fe_values,
+                          const Vector<double> &       local_dof_values,
+                          std::vector<Vector<double>> &residuals) const;
+
+  /**
+   * "residual"和"dwr"估计器中，面上法向导数的跳跃乘以的系数。默认为空，
+   * 即系数为1。
+   */
+  virtual const Function<dim> *
+  estimator_coefficient() const;
+
+
+  /**
+   * 在本地拥有的单元上做一次多线程循环，同时计算`error_norms`中所有的误差范数、
+   * "exact"和"residual"估计器的单元项，以及全局估计值，并把它们写入当前的误差表格。
+   *
+   * @param solution 包含本地相关自由度的解向量。
+   * @param compute_estimator 是否把单元项加到`error_per_cell`上。
+   */
+  template <typename VectorType>
+  void
+  evaluate_errors(const VectorType &solution,
+                  const bool        compute_estimator = true);
 
   /**
    * 根据所选择的策略，标记一些单元格进行细化。
@@ -214,9 +443,9 @@ protected:
 
 
   /**
-   * 细化网格
+   * 细化网格。派生类可以重载它，在网格改变前后转移需要保留的向量。
    */
-  void
+  virtual void
   refine_grid();
 
   /**
@@ -225,6 +454,96 @@ protected:
   virtual void
   setup_system();
 
+  /**
+   * 用当前的参数和常数重新初始化外力项、精确解以及Dirichlet和Neumann边界条件。
+   */
+  void
+  initialize_functions();
+
+  /**
+   * 按照`dof_renumbering`选择的策略对自由度重新编号。在distribute_dofs()之后、建立约束和稀疏模式之前调用。
+   */
+  void
+  renumber_dofs();
+
+  /**
+   * 系统矩阵的带宽，即稀疏模式中非零元素的行号与列号之差的最大值，在所有进程上
+   * 取最大值。必须在setup_system()之后调用。
+   */
+  virtual types::global_dof_index
+  matrix_bandwidth() const;
+
+  /**
+   * 输出矩阵带宽和矩阵-向量乘积的平均时间，用来比较不同的自由度编号。
+   */
+  virtual void
+  print_matrix_statistics();
+
+  /**
+   * 根据"Preconditioner"小节中的参数构造AMG的参数。派生类可以重载它来提供
+   * 更合适的近零空间，例如线性弹性的刚体模态。
+   *
+   * @param dofs 矩阵所在的空间，近零空间在它上面计算。
+   */
+  virtual TrilinosWrappers::PreconditionAMG::AdditionalData
+  amg_data(const DoFHandler<dim> &dofs) const;
+
+  /**
+   * 在第`cycle`个循环的解上计算"Diagnostics"小节中要求的量。
+   * BaseBlockProblem用块向量重载它。
+   */
+  virtual void
+  diagnostics(const unsigned int cycle);
+
+  /**
+   * 用RemotePointEvaluation计算探针和折线采样点上的值，在给定的边界上积分
+   * 各个分量，并由零号进程写入`diagnostics_filename_<cycle>.csv`。
+   */
+  template <typename VectorType>
+  void
+  write_diagnostics(const VectorType &solution, const unsigned int cycle);
+
+  /**
+   * 在`relevant_dofs`上重新构造`constraints`：只在有悬挂节点时生成悬挂节点约束，
+   * 所有Dirichlet边界通过一次interpolate_boundary_values()处理。
+   */
+  void
+  make_constraints(const IndexSet &relevant_dofs);
+
+  /**
+   * 根据`mapping_degree`和`cache_mapping`创建`mapping`。
+   */
+  void
+  create_mapping();
+
+  /**
+   * 使用MappingQCache时，如果网格在上次计算之后改变了，则重新计算所有单元的
+   * 映射支撑点。在setup_system()中调用，每个网格只计算一次。
+   */
+  void
+  update_mapping_cache();
+
+  /**
+   * 装配同一个WorkStream任务中的一批单元，它们使用相同的有限元，最多有
+   * `VectorizedArray<double>::size()`个。默认对每个单元调用assemble_system_one_cell()；
+   * 派生类可以重载它，让每个单元占据VectorizedArray的一个通道。
+   *
+   * @param cells 这一批单元。
+   * @param scratch 这些单元的有限元对应的ScratchData。
+   * @param copies 每个单元一个CopyData，大小已经调整好。
+   */
+  virtual void
+  assemble_system_batch(
+    const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+    ScratchData &                                                      scratch,
+    std::vector<CopyData> &                                            copies);
+
+  /**
+   * 装配使用的线程局部ScratchData池，第一次调用时根据`fe_collection`和`mapping`构造。
+   */
+  Threads::ThreadLocalStorage<std::vector<ScratchData>> &
+  get_assembly_scratch();
+
   /**
    * 在setup_system()结束时调用的信号。
    */
@@ -241,6 +560,41 @@ protected:
   virtual void
   assemble_system();
 
+  /**
+   * 只重新组装右手边，系统矩阵保持不变。`system_rhs`中只包含齐次约束下的贡献，非齐次边界条件的提升项由调用者负责。
+   */
+  void
+  assemble_rhs();
+
+  /**
+   * 荷载工况的数目，即两个荷载工况表达式列表中较长者的长度。
+   */
+  unsigned int
+  n_load_cases() const;
+
+  /**
+   * 用第`load_case`个荷载工况的表达式重新初始化外力项和Neumann边界条件。
+   *
+   * @param load_case 荷载工况的编号。
+   */
+  void
+  set_load_case(const unsigned int load_case);
+
+  /**
+   * 在完整组装之后计算非齐次约束的提升项`lift`：完整的右手边减去齐次的右手边。
+   * 返回时`system_rhs`仍然是完整的右手边。
+   */
+  void
+  compute_lift();
+
+  /**
+   * 对所有荷载工况重复使用已组装好的矩阵和预条件子：只组装右手边，然后求解、估计并输出。
+   *
+   * @param cycle 网格加密循环次数
+   */
+  void
+  solve_load_cases(const unsigned int cycle);
+
 
   /**
    * 以Paraview或Visit可以读取的格式输出解决方案和网格。
@@ -262,10 +616,15 @@ protected:
   MPI_Comm mpi_communicator;
 
   /**
-   * 用于多线程装配的线程数。
+   * 每个进程使用的线程数。小于等于零时，把节点上的核平均分给节点上的所有进程。
    */
   int number_of_threads = -1;
 
+  /**
+   * 是否把每个进程的线程绑定到一段连续的核上（只在Linux上支持）。
+   */
+  bool pin_threads = false;
+
   /**
    * 只在零号处理器上输出。
    */
@@ -289,6 +648,39 @@ protected:
    */
   std::unique_ptr<FiniteElement<dim>> fe;
 
+  /**
+   * 有限元空间的集合。hp模式下包含FE_Q(1)到FE_Q(`max_degree`)，否则只包含`fe`。
+   * 每个单元使用的元素由`cell->active_fe_index()`给出。
+   */
+  hp::FECollection<dim> fe_collection;
+
+  /**
+   * hp模式下用于计算Legendre系数的对象，第一次标记时创建。
+   */
+  std::unique_ptr<FESeries::Legendre<dim>> legendre;
+
+  /**
+   * hp模式下用于计算Fourier系数的对象，第一次标记时创建。
+   */
+  std::unique_ptr<FESeries::Fourier<dim>> fourier;
+
+  /**
+   * hp模式下按每个单元的自由度数进行负载平衡。
+   */
+  std::unique_ptr<parallel::CellWeights<dim>> cell_weights;
+
+  /**
+   * 在多次装配之间重复使用的ScratchData，每个线程一份，每个有限元一个。
+   * 只有在有限元或映射重新创建时才被清空。
+   */
+  std::unique_ptr<Threads::ThreadLocalStorage<std::vector<ScratchData>>>
+    assembly_scratch;
+
+  /**
+   * Debug模式下，装配的worker在所有单元上进行堆分配的总次数。
+   */
+  std::atomic<std::size_t> n_assembly_allocations{0};
+
   /**
    * 参考元素和真实元素之间的映射。
    *
@@ -345,10 +737,46 @@ protected:
   Vector<float> error_per_cell;
 
   /**
-   * 在 "精确 "估计器、"凯利 "估计器和 "残差 "估计器之间选择。
+   * 在 "精确 "估计器、"凯利 "估计器、"残差 "估计器和面向目标的 "dwr "估计器之间选择。
    */
   std::string estimator_type = "exact";
 
+  /**
+   * "dwr"估计器的目标泛函："point_value|domain_integral|boundary_integral"。
+   */
+  std::string goal_functional = "point_value";
+
+  /**
+   * "point_value"的求值点。
+   */
+  Point<dim> goal_point;
+
+  /**
+   * "boundary_integral"的积分边界。只有Neumann边界上的积分有意义，
+   * Dirichlet边界上的对偶解为零。
+   */
+  std::set<types::boundary_id> goal_boundary_ids;
+
+  /**
+   * 目标泛函作用的分量。
+   */
+  unsigned int goal_component = 0;
+
+  /**
+   * 每个单元上对偶解的权重，与`error_per_cell`的长度相同。
+   */
+  Vector<float> dual_weights;
+
+  /**
+   * 对偶问题的自由度，有限元比原始问题高一阶。
+   */
+  DoFHandler<dim> dual_dof_handler;
+
+  /**
+   * 对偶解的只读副本，包含`dual_dof_handler`上本地相关的自由度。
+   */
+  LA::MPI::Vector locally_relevant_dual_solution;
+
   /**
    * 在 "全局"、"固定_分数"（也称为Dorfler标记策略）和 "固定_数字"之间选择。
    */
@@ -389,16 +817,153 @@ protected:
    */
   std::string fe_name = "FE_Q(1)";
 
+  /**
+   * 是否使用hp自适应：根据解的光滑性在h加密和p加密之间选择。只适用于标量问题。
+   */
+  bool use_hp = false;
+
+  /**
+   * hp模式下最高的多项式次数。
+   */
+  unsigned int max_degree = 5;
+
+  /**
+   * hp模式下的光滑性估计器："legendre|fourier"。
+   */
+  std::string smoothness_estimator = "legendre";
+
+  /**
+   * 在被标记为加密（粗化）的单元中，改为p加密（p粗化）的比例。
+   */
+  std::pair<double, double> p_refinement_and_coarsening_fractions = {0.9,
+                                                                     0.9};
+
   /**
    * 参考元素和实际元素之间的映射程度。
    */
   unsigned int mapping_degree = 1;
 
+  /**
+   * 用MappingQCache代替MappingQGeneric：每个单元的支撑点只从流形计算一次，
+   * 之后装配、边界值、误差估计和输出都直接使用缓存的点。
+   */
+  bool cache_mapping = false;
+
+  /**
+   * MappingQCache中的支撑点是否属于当前的网格。网格的任何改变都会使它失效。
+   */
+  bool mapping_cache_is_current = false;
+
+  /**
+   * 网格改变时使映射缓存失效的信号连接。它声明在triangulation之后，因此会先于
+   * triangulation析构，并在析构时自动断开，网格的信号不会再调用已销毁的对象。
+   */
+  boost::signals2::scoped_connection mapping_cache_connection;
+
   /**
    * 仿真开始前要进行的预加密的次数。
    */
   unsigned int n_refinements = 4;
 
+  /**
+   * 自由度重新编号的策略：
+   * "none|cuthill_mckee|hierarchical|matrix_free_data_locality|downstream"。
+   */
+  std::string dof_renumbering = "none";
+
+  /**
+   * "downstream"编号所用的方向。
+   */
+  Tensor<1, dim> downstream_direction;
+
+  /**
+   * 每次组装后是否输出矩阵带宽和矩阵-向量乘积的时间。
+   */
+  bool report_matrix_statistics = false;
+
+  /**
+   * 按VectorizedArray的宽度成批装配单元，见assemble_system_batch()。
+   */
+  bool batched_assembly = false;
+
+  /**
+   * DG模式下内罚项的系数，乘以 $p(p+1)/h$。
+   */
+  double dg_penalty = 2;
+
+  /**
+   * DG模式下的预条件子："amg|block_jacobi"。块Jacobi的每一块是一个单元上的自由度。
+   */
+  std::string dg_preconditioner = "amg";
+
+  /**
+   * 在加密循环之间按支撑点缓存Dirichlet边界值，没有改变的边界单元不再重新计算。
+   */
+  bool cache_boundary_values = true;
+
+  /**
+   * 是否把外力项、精确解和边界条件的表达式作为时间`t`的函数来解析。
+   * 与时间有关的问题在构造函数中设置它，并用set_time()改变时间。
+   */
+  bool time_dependent_functions = false;
+
+  /**
+   * 输出格式："vtu|none"。为none时output_results()什么也不写。
+   */
+  std::string output_format = "vtu";
+
+  /**
+   * 每个循环中输出解的值的点。
+   */
+  std::vector<Point<dim>> probe_points;
+
+  /**
+   * 每个循环中沿着它们输出解的折线，每条折线由它的顶点给出。
+   */
+  std::vector<std::vector<Point<dim>>> polylines;
+
+  /**
+   * 折线的每一段上的采样点数。
+   */
+  unsigned int points_per_polyline_segment = 10;
+
+  /**
+   * 在这些边界上积分解的每个分量。
+   */
+  std::set<types::boundary_id> boundary_integral_ids;
+
+  /**
+   * 诊断量的CSV文件名的前缀。
+   */
+  std::string diagnostics_filename = "diagnostics";
+
+  /**
+   * 探针和折线采样点的定位结果。只有网格、映射或采样点改变之后，
+   * write_diagnostics()才重新定位，否则每个循环直接用它计算点值。
+   */
+  std::unique_ptr<Utilities::MPI::RemotePointEvaluation<dim>>
+    diagnostic_evaluation;
+
+  /**
+   * `diagnostic_evaluation`定位时使用的采样点。
+   */
+  std::vector<Point<dim>> diagnostic_points;
+
+  /**
+   * `diagnostic_evaluation`是否属于当前的网格。网格的任何改变都会使它失效。
+   */
+  bool diagnostic_evaluation_is_current = false;
+
+  /**
+   * 网格改变时使`diagnostic_evaluation`失效的信号连接。
+   */
+  boost::signals2::scoped_connection diagnostic_evaluation_connection;
+
+  /**
+   * 带缓存的`dirichlet_boundary_condition`。
+   */
+  std::unique_ptr<CachedFunction<dim>> cached_dirichlet_boundary_condition;
+
   /**
    * 要执行的求解-估计-标记-细化循环的数量。
    */
@@ -444,6 +1009,44 @@ protected:
    */
   std::string neumann_boundary_conditions_expression = "0";
 
+  /**
+   * 每个荷载工况的外力项表达式，用`|`分隔。为空时只求解一个工况。
+   */
+  std::vector<std::string> load_case_forcing_term_expressions;
+
+  /**
+   * 每个荷载工况的Neumann边界条件表达式，用`|`分隔。
+   */
+  std::vector<std::string> load_case_neumann_boundary_conditions_expressions;
+
+  /**
+   * 当前正在求解的荷载工况。没有荷载工况时为`numbers::invalid_unsigned_int`。
+   */
+  unsigned int current_load_case = numbers::invalid_unsigned_int;
+
+  /**
+   * 如果为真，assemble_system_one_cell()可以跳过局部矩阵的计算，copy_one_cell()只分配右手边。
+   */
+  bool assemble_rhs_only = false;
+
+  /**
+   * 如果为假，setup_system()不建立稀疏模式，也不分配系统矩阵。
+   * 只使用无矩阵算子的派生类（例如显式动力学）可以关闭它。
+   */
+  bool allocate_system_matrix = true;
+
+  /**
+   * 非齐次约束对右手边的贡献，只依赖于矩阵和Dirichlet边界条件。
+   * 由compute_lift()计算，用于荷载工况和集成模式中只改变右手边的运行。
+   */
+  LA::MPI::Vector lift;
+
+  /**
+   * 集成模式中这次运行只改变了右手边：run_refinement_cycles()保留上一次运行的
+   * 自由度、约束、矩阵和它的分解，只重新组装右手边。
+   */
+  bool reuse_system = false;
+
   /**
    * pre-refinement 的表达式。
    */
@@ -460,15 +1063,204 @@ protected:
   std::string grid_generator_arguments = "0: 1: false";
 
   /**
-   * 一个用于输出收敛错误的表格。
+   * 网格文件的名称（.msh、.vtk、.inp等，格式由扩展名决定）。
+   * 如果不为空，则代替`grid_generator_function`生成粗网格。
+   */
+  std::string grid_input_file = "";
+
+  /**
+   * 存放预加密网格的目录（必须已经存在）。为空时不使用缓存。
+   */
+  std::string mesh_cache_directory = "";
+
+  /**
+   * 从run()开始计时，用于print_startup_statistics()。
+   */
+  Timer startup_timer;
+
+  /**
+   * 每个分量在误差表格中的名称。同名的分量一起计算误差。
+   */
+  std::vector<std::string> error_component_names;
+
+  /**
+   * evaluate_errors()对每组分量计算的误差范数。
+   */
+  std::set<VectorTools::NormType> error_norms = {VectorTools::Linfty_norm,
+                                                 VectorTools::L2_norm,
+                                                 VectorTools::H1_norm};
+
+  /**
+   * 一个用于输出收敛错误的表格。它自己不计算任何范数（见parse_parameters()），
+   * 误差由evaluate_errors()一次算好后作为额外的列加入。
    */
   ParsedConvergenceTable error_table;
 
+  /**
+   * "Error table"中"List of error norms to compute"的默认值，即不计算任何范数。
+   */
+  std::string default_error_table_norms;
+
+  /**
+   * evaluate_errors()最近一次计算的误差和估计子，键是误差表格中的列名。
+   */
+  std::map<std::string, double> latest_errors;
+
+  /**
+   * 每个荷载工况的误差表格。
+   */
+  std::vector<ParsedConvergenceTable> load_case_error_tables;
+
+  /**
+   * 每个荷载工况在最后一个加密循环中的误差，格式与`latest_errors`相同。
+   */
+  std::vector<std::map<std::string, double>> load_case_errors;
+
+  /**
+   * 参数扫描中当前这次运行的误差表格，从`error_table`拷贝构造。
+   */
+  std::unique_ptr<ParsedConvergenceTable> run_error_table;
+
+  /**
+   * 当前应该写入的误差表格：正在求解某个荷载工况时是该工况的表格，
+   * 参数扫描中是这次运行的表格，否则是`error_table`。
+   */
+  ParsedConvergenceTable &
+  current_error_table();
+
   /**
    * 用于存储求解器参数的类，如最大迭代次数、绝对公差和相对公差。
    */
   ParameterAcceptorProxy<ReductionControl> solver_control;
 
+  /**
+   * 强制使用直接求解器，而不是CG+AMG。
+   */
+  bool use_direct_solver = false;
+
+  /**
+   * 当自由度总数不超过该值时，自动切换到直接求解器。零表示从不自动切换。
+   */
+  types::global_dof_index direct_solver_dofs_threshold = 0;
+
+  /**
+   * Amesos 求解器的名称，例如 "Amesos_Klu" 或 "Amesos_Mumps"。
+   */
+  std::string direct_solver_type = "Amesos_Klu";
+
+  /**
+   * 线性代数的后端："trilinos|native"。native只能在一个进程上使用：矩阵和右手边
+   * 装配到deal.II自己的SparseMatrix和Vector中，用deal.II的预条件子和CG求解，
+   * 解再拷贝到`solution`中。
+   */
+  std::string linear_algebra_backend = "trilinos";
+
+  /**
+   * native后端的预条件子："ssor|jacobi|chebyshev"。
+   */
+  std::string native_preconditioner = "ssor";
+
+  /**
+   * native后端的稀疏模式。
+   */
+  SparsityPattern native_sparsity;
+
+  /**
+   * native后端的系统矩阵。
+   */
+  SparseMatrix<double> native_matrix;
+
+  /**
+   * native后端的右手边。
+   */
+  Vector<double> native_rhs;
+
+  /**
+   * native后端的解。
+   */
+  Vector<double> native_solution;
+
+  /**
+   * 迭代求解器："cg"是经典CG，每一步两次阻塞的归约；"pipelined_cg"把唯一的一次归约
+   * 与预条件子和矩阵-向量乘积重叠；"single_reduction_cg"的归约是阻塞的。
+   */
+  std::string iterative_solver = "cg";
+
+  /**
+   * 流水线CG每隔多少步用真实残差替换递推的残差。
+   */
+  unsigned int residual_replacement_interval = 50;
+
+  /**
+   * 输出迭代次数和每一步的平均时间。
+   */
+  bool report_solver_statistics = false;
+
+  /**
+   * 缓存的系统矩阵分解。只要系统矩阵没有被重新组装，它就会在多次调用solve()之间被重复使用。
+   */
+  std::unique_ptr<TrilinosWrappers::SolverDirect> direct_solver;
+
+  /**
+   * 缓存的AMG预条件子。与`direct_solver`一样，只有在系统矩阵改变后才重新构建。
+   */
+  std::unique_ptr<LA::MPI::PreconditionAMG> amg;
+
+  /**
+   * DG模式下缓存的块Jacobi预条件子。
+   */
+  std::unique_ptr<TrilinosWrappers::PreconditionBlockJacobi> block_jacobi;
+
+  /**
+   * AMG是否针对椭圆型问题（Chebyshev光滑子和更激进的粗化）。
+   */
+  bool amg_elliptic = true;
+
+  /**
+   * 是否针对高阶有限元调整AMG的粗化。
+   */
+  bool amg_higher_order_elements = false;
+
+  /**
+   * 每次应用预条件子时的多重网格循环次数。
+   */
+  unsigned int amg_n_cycles = 1;
+
+  /**
+   * 使用W循环而不是V循环。
+   */
+  bool amg_w_cycle = false;
+
+  /**
+   * 聚合时忽略的矩阵元素的相对大小。
+   */
+  double amg_aggregation_threshold = 1e-4;
+
+  /**
+   * 每一层上的光滑步数。
+   */
+  unsigned int amg_smoother_sweeps = 2;
+
+  /**
+   * 并行时光滑子在相邻进程之间的重叠层数。
+   */
+  unsigned int amg_smoother_overlap = 0;
+
+  /**
+   * ML的光滑子类型。
+   */
+  std::string amg_smoother_type = "Chebyshev";
+
+  /**
+   * ML最粗一层上的求解器。
+   */
+  std::string amg_coarse_type = "Amesos-KLU";
+
+  /**
+   * 对向量值问题，把每个分量的常数函数作为近零空间传给AMG。
+   */
+  bool amg_component_constant_modes = true;
+
   /**
    * 测试员类的名称。
    */
@@ -500,7 +1292,11 @@ run(int argc, char **argv)
 
       ProblemType base_problem;
       base_problem.initialize(par_name);
-      base_problem.run();
+      // 第二个参数是可选的参数扫描文件
+      if (argc > 2)
+        base_problem.run_ensemble(argv[2]);
+      else
+        base_problem.run();
     }
   catch (std::exception &exc)
     {
@@ -0,0 +1,130 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef cached_function_include_file
+#define cached_function_include_file
+
+#include <deal.II/base/function.h>
+#include <deal.II/base/point.h>
+
+#include <deal.II/lac/vector.h>
+
+#include <map>
+
+using namespace dealii;
+
+/**
+ * 记住每个点上函数值的Function。
+ *
+ * 在两次加密循环之间，没有改变的边界单元上的支撑点坐标完全相同，
+ * 所以它们的边界值可以直接从上一次的结果中取出，而不必重新计算FunctionParser。
+ * 调用next_cycle()后，只保留上一个循环中用到的点。
+ *
+ * 这个类不是线程安全的：它只能用在串行的调用中，例如
+ * VectorTools::interpolate_boundary_values()。
+ */
+template <int dim>
+class CachedFunction : public Function<dim>
+{
+public:
+  /**
+   * 构造函数。`function`必须比这个对象存在得更久。
+   */
+  CachedFunction(const Function<dim> &function)
+    : Function<dim>(function.n_components)
+    , function(function)
+  {}
+
+  virtual void
+  vector_value(const Point<dim> &p, Vector<double> &values) const override
+  {
+    values = lookup(p);
+  }
+
+  virtual double
+  value(const Point<dim> &p, const unsigned int component = 0) const override
+  {
+    return lookup(p)[component];
+  }
+
+  /**
+   * 丢弃上一个循环中没有用到的点。
+   */
+  void
+  next_cycle()
+  {
+    cache.swap(used);
+    used.clear();
+    n_evaluations = 0;
+  }
+
+  /**
+   * 从上一次调用next_cycle()以来，真正计算函数的次数。
+   */
+  mutable unsigned int n_evaluations = 0;
+
+private:
+  /**
+   * 按坐标的字典序比较两个点。
+   */
+  struct PointLess
+  {
+    bool
+    operator()(const Point<dim> &a, const Point<dim> &b) const
+    {
+      for (unsigned int d = 0; d < dim; ++d)
+        if (a[d] != b[d])
+          return a[d] < b[d];
+      return false;
+    }
+  };
+
+  const Vector<double> &
+  lookup(const Point<dim> &p) const
+  {
+    auto it = used.find(p);
+    if (it != used.end())
+      return it->second;
+
+    auto cached = cache.find(p);
+    if (cached != cache.end())
+      return used.emplace(p, cached->second).first->second;
+
+    Vector<double> values(this->n_components);
+    function.vector_value(p, values);
+    ++n_evaluations;
+    return used.emplace(p, std::move(values)).first->second;
+  }
+
+  const Function<dim> &function;
+
+  /**
+   * 上一个循环中的函数值。
+   */
+  mutable std::map<Point<dim>, Vector<double>, PointLess> cache;
+
+  /**
+   * 当前循环中用到的函数值。
+   */
+  mutable std::map<Point<dim>, Vector<double>, PointLess> used;
+};
+
+#endif
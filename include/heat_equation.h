@@ -0,0 +1,194 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef heat_equation_include_file
+#define heat_equation_include_file
+
+#include <deal.II/distributed/solution_transfer.h>
+
+#include "base_problem.h"
+
+// Forward declare the tester class
+template <typename Integral>
+class HeatEquationTester;
+
+using namespace dealii;
+
+/**
+ * 用theta格式求解热方程 $\partial_t u - \Delta u = f$。
+ *
+ * 质量矩阵 $M$ 和刚度矩阵 $A$ 在每个网格上只组装一次，每一步的系统矩阵
+ * $M + \theta k A$ 由它们相加得到。只要网格和时间步长 $k$ 不变，
+ * 系统矩阵和它的AMG预条件子就在时间步之间重复使用。
+ *
+ * 外力项、边界条件和精确解的表达式可以依赖于时间`t`。
+ */
+template <int dim>
+class HeatEquation : public BaseProblem<dim>
+{
+public:
+  /**
+   * 构造函数。初始化所有参数，包括基类，并确保该类可以运行。
+   */
+  HeatEquation();
+
+  /**
+   * 销毁热方程对象
+   */
+  virtual ~HeatEquation() = default;
+
+  using CopyData    = typename BaseProblem<dim>::CopyData;
+  using ScratchData = typename BaseProblem<dim>::ScratchData;
+
+  /**
+   * 从初值开始时间步进到`final_time`，每隔`refinement_interval`步调整一次网格，
+   * 最后在终止时刻计算误差。
+   */
+  virtual void
+  run() override;
+
+protected:
+  /**
+   * theta格式的系统矩阵 $M + \theta k A$ 和它的预条件子。
+   */
+  struct ThetaOperator
+  {
+    /**
+     * 格式的参数 $\theta$。
+     */
+    double theta = 1;
+
+    /**
+     * 构造`matrix`时的时间步长。为零表示需要重新构造。
+     */
+    double time_step = 0;
+
+    LA::MPI::SparseMatrix matrix;
+
+    std::unique_ptr<LA::MPI::PreconditionAMG> preconditioner;
+  };
+
+  /**
+   * 在当前网格上组装质量矩阵和刚度矩阵，并保存每个单元上的局部矩阵，
+   * 以便之后的右端项不必重新积分。
+   */
+  virtual void
+  assemble_system() override;
+
+  /**
+   * 如果时间步长改变了，重新构造`op`的系统矩阵和预条件子。
+   */
+  void
+  make_operator(ThetaOperator &op, const double time_step);
+
+  /**
+   * 从`locally_relevant_solution`中时刻`time`的解出发，用`op`做一步长度为
+   * `time_step`的theta格式，结果存放在`solution`中。
+   */
+  void
+  do_time_step(ThetaOperator &op, const double time, const double time_step);
+
+  /**
+   * 按Kelly估计器标记单元，加密网格，并把解转移到新的网格上。
+   */
+  void
+  refine_mesh();
+
+  /**
+   * 设置所有与时间有关的函数的时间。
+   */
+  void
+  set_time(const double time);
+
+  /**
+   * 初值。
+   */
+  FunctionParser<dim> initial_condition;
+
+  /**
+   * 初值的表达式。
+   */
+  std::string initial_condition_expression = "0";
+
+  /**
+   * theta格式的参数：0.5是Crank-Nicolson格式，1是向后Euler格式。
+   */
+  double theta = 0.5;
+
+  /**
+   * 终止时刻。
+   */
+  double final_time = 1;
+
+  /**
+   * 第一步的时间步长。
+   */
+  double initial_time_step = 1e-2;
+
+  /**
+   * 自适应时间步长的下界和上界。
+   */
+  double minimum_time_step = 1e-6;
+  double maximum_time_step = 1e-1;
+
+  /**
+   * 每一步的局部误差容限。为零时使用固定的时间步长。
+   */
+  double time_step_tolerance = 0;
+
+  /**
+   * 每隔多少步调整一次网格。零表示不调整。
+   */
+  unsigned int refinement_interval = 0;
+
+  /**
+   * 每隔多少步输出一次解。零表示不输出。
+   */
+  unsigned int output_interval = 1;
+
+  /**
+   * 质量矩阵和刚度矩阵，已经按`constraints`消去了受约束的自由度。
+   */
+  LA::MPI::SparseMatrix mass_matrix;
+  LA::MPI::SparseMatrix stiffness_matrix;
+
+  /**
+   * 每个本地单元上的局部质量矩阵和刚度矩阵，按active_cell_index()存放。
+   */
+  std::vector<FullMatrix<double>> local_mass_matrices;
+  std::vector<FullMatrix<double>> local_stiffness_matrices;
+
+  /**
+   * 前进所用的格式。
+   */
+  ThetaOperator theta_operator;
+
+  /**
+   * 估计局部误差所用的另一个格式：theta为1时是Crank-Nicolson格式，
+   * 否则是向后Euler格式。
+   */
+  ThetaOperator embedded_operator;
+
+  template <typename Integral>
+  friend class HeatEquationTester;
+};
+
+#endif
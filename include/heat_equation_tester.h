@@ -0,0 +1,21 @@
+#ifndef heat_equation_tester_h
+#define heat_equation_tester_h
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "heat_equation.h"
+
+using namespace dealii;
+
+//  热方程的测试，使用积分常数
+template <class Integral>
+class HeatEquationTester : public ::testing::Test,
+                           public HeatEquation<Integral::value>
+{
+public:
+  HeatEquationTester() = default;
+};
+
+#endif
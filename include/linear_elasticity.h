@@ -22,7 +22,17 @@
 #ifndef linear_elasticity_include_file
 #define linear_elasticity_include_file
 
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include <deal.II/matrix_free/fe_evaluation.h>
+#include <deal.II/matrix_free/matrix_free.h>
+
+#ifdef DEAL_II_ARPACK_WITH_PARPACK
+#  include <deal.II/lac/parpack_solver.h>
+#endif
+
 #include "base_problem.h"
+#include "lobpcg.h"
 
 // Forward declare the tester class
 template <typename Integral>
@@ -51,6 +61,18 @@ public:
   using CopyData    = typename BaseProblem<dim>::CopyData;
   using ScratchData = typename BaseProblem<dim>::ScratchData;
 
+  /**
+   * 显式动力学模式下的向量类型。
+   */
+  using VectorType = LinearAlgebra::distributed::Vector<double>;
+
+  /**
+   * 如果设置了`explicit_dynamics`，用中心差分格式做显式时间积分；如果设置了
+   * `eigen_analysis`，求最低的几个振动模态；否则求解静力问题。
+   */
+  virtual void
+  run() override;
+
 protected:
   /**
    * 显式组装线性弹性问题。
@@ -61,6 +83,102 @@ protected:
     ScratchData &                                         scratch,
     CopyData &                                            copy);
 
+  /**
+   * 用刚体模态作为AMG的近零空间，使CG的迭代次数不依赖于网格尺寸。
+   */
+  virtual TrilinosWrappers::PreconditionAMG::AdditionalData
+  amg_data(const DoFHandler<dim> &dofs) const override;
+
+  /**
+   * 强形式的残差 $f + \nabla\cdot(\mu\varepsilon(u_h) + \lambda\nabla\cdot u_h I)$。
+   */
+  virtual void
+  compute_strong_residual(
+    const FEValues<dim> &        fe_values,
+    const Vector<double> &       local_dof_values,
+    std::vector<Vector<double>> &residuals) const override;
+
+  /**
+   * 用中心差分格式求解 $\rho \ddot u + A u = f$，直到`final_time`。
+   * 质量矩阵是对角的，每一步只需要一次刚度矩阵的无矩阵作用，不求解任何方程组。
+   */
+  void
+  run_explicit_dynamics();
+
+  /**
+   * 建立MatrixFree对象，计算集中质量矩阵的逆、初始时刻的载荷向量和由CFL条件
+   * 决定的时间步长。
+   */
+  void
+  setup_explicit_dynamics();
+
+  /**
+   * 计算时刻`time`的载荷向量，包括外力项和Neumann边界条件。
+   */
+  void
+  assemble_load_vector(const double time);
+
+  /**
+   * 用FEEvaluation计算 $dst = A src$。受约束的自由度上的结果为零。
+   */
+  void
+  apply_stiffness(VectorType &dst, const VectorType &src) const;
+
+  /**
+   * 计算加速度 $M^{-1}(f - A u)$。
+   */
+  void
+  compute_acceleration(VectorType &      acceleration,
+                       const VectorType &displacement) const;
+
+  /**
+   * 在一个网格上组装刚度矩阵和质量矩阵，求 $Ku = \lambda Mu$ 最小的
+   * `n_modes`个特征对，输出特征值、频率和模态。如果`compare_with_shift_invert`，
+   * 再用基于直接求解器的移位求逆迭代求一次，比较时间和特征值。
+   */
+  void
+  run_eigen_analysis();
+
+  /**
+   * 用与刚度矩阵相同的稀疏模式组装一致质量矩阵`mass_matrix`。
+   */
+  void
+  assemble_mass_matrix();
+
+  /**
+   * 满足齐次约束的确定性初始向量，与进程数无关。
+   */
+  std::vector<LA::MPI::Vector>
+  initial_mode_guesses(const unsigned int n) const;
+
+  /**
+   * 以solve()中缓存的AMG作为预条件子的LOBPCG。
+   */
+  void
+  solve_lobpcg(std::vector<double> &         eigenvalues,
+               std::vector<LA::MPI::Vector> &modes);
+
+  /**
+   * 移位求逆的子空间迭代：每一步用缓存的 $K - \sigma M$ 的分解求解一次，
+   * 再做Rayleigh-Ritz投影。子空间比所求的模态数大，以加快收敛。
+   */
+  void
+  solve_shift_invert(std::vector<double> &         eigenvalues,
+                     std::vector<LA::MPI::Vector> &modes);
+
+  /**
+   * 用PARPACK的移位求逆模式，需要deal.II配置了PARPACK。
+   */
+  void
+  solve_arpack(std::vector<double> &         eigenvalues,
+               std::vector<LA::MPI::Vector> &modes);
+
+  /**
+   * $K - \sigma M$ 的分解。移位为零时就是solve()中缓存的`direct_solver`。
+   */
+  TrilinosWrappers::SolverDirect &
+  shift_invert_factorization();
+
   /**
    * 在装配程序中使用的提取器。
    */
@@ -70,6 +188,115 @@ protected:
   double mu     = 1;
   double lambda = 1;
 
+  /**
+   * 是否用显式动力学代替静力问题。
+   */
+  bool explicit_dynamics = false;
+
+  /**
+   * 密度。
+   */
+  double density = 1;
+
+  /**
+   * 显式动力学的终止时刻。
+   */
+  double final_time = 1;
+
+  /**
+   * 时间步长与稳定性界限之比。
+   */
+  double cfl_number = 0.5;
+
+  /**
+   * 每隔多少步输出一次位移。零表示只输出最后的结果。
+   */
+  unsigned int explicit_output_interval = 0;
+
+  /**
+   * 初始位移和初始速度的表达式。
+   */
+  std::string initial_displacement_expression =
+    dim == 1 ? "0" : dim == 2 ? "0; 0" : "0; 0; 0";
+  std::string initial_velocity_expression =
+    dim == 1 ? "0" : dim == 2 ? "0; 0" : "0; 0; 0";
+
+  FunctionParser<dim> initial_displacement;
+  FunctionParser<dim> initial_velocity;
+
+  /**
+   * 第0个积分公式是Gauss公式，用于刚度矩阵和载荷；第1个是与FE_Q的支撑点
+   * 重合的Gauss-Lobatto公式，用它积分的质量矩阵是对角的。
+   */
+  MatrixFree<dim, double> matrix_free;
+
+  /**
+   * 集中质量矩阵的逆。受约束的自由度上为零，因此它们的加速度为零。
+   */
+  VectorType inverse_lumped_mass;
+
+  /**
+   * 当前时刻的载荷向量，包括外力项和Neumann边界条件。
+   */
+  VectorType load_vector;
+
+  /**
+   * 由CFL条件决定的时间步长。
+   */
+  double explicit_time_step = 0;
+
+  /**
+   * 是否用特征值分析代替静力问题。
+   */
+  bool eigen_analysis = false;
+
+  /**
+   * 所求的模态数。
+   */
+  unsigned int n_modes = 6;
+
+  /**
+   * 特征值求解器："lobpcg|shift_invert|arpack"。
+   */
+  std::string eigen_solver = "lobpcg";
+
+  /**
+   * 移位求逆中的移位 $\sigma$，应小于所求的最小特征值。
+   */
+  double eigen_shift = 0;
+
+  /**
+   * 特征值求解器的相对残差容限和最大迭代次数。
+   */
+  double       eigen_tolerance      = 1e-8;
+  unsigned int eigen_max_iterations = 500;
+
+  /**
+   * 是否再用移位求逆迭代求一次作为基准，比较时间和特征值。
+   */
+  bool compare_with_shift_invert = false;
+
+  /**
+   * 一致质量矩阵，密度取自"Explicit dynamics"小节。
+   */
+  LA::MPI::SparseMatrix mass_matrix;
+
+  /**
+   * 移位不为零时的 $K - \sigma M$ 及其缓存的分解。
+   */
+  LA::MPI::SparseMatrix                           shifted_matrix;
+  std::unique_ptr<TrilinosWrappers::SolverDirect> shifted_solver;
+
+  /**
+   * 求得的特征值，从小到大。
+   */
+  std::vector<double> eigenvalues;
+
+  /**
+   * 模态的只读副本，包含本地相关的自由度，通过`add_data_vector`输出。
+   */
+  std::vector<LA::MPI::Vector> mode_shapes;
+
   template <typename Integral>
   friend class LinearElasticityTester;
 };
@@ -0,0 +1,21 @@
+#ifndef linear_elasticity_tester_h
+#define linear_elasticity_tester_h
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "linear_elasticity.h"
+
+using namespace dealii;
+
+//  线性弹性问题的测试，使用积分常数
+template <class Integral>
+class LinearElasticityTester : public ::testing::Test,
+                               public LinearElasticity<Integral::value>
+{
+public:
+  LinearElasticityTester() = default;
+};
+
+#endif
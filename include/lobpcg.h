@@ -0,0 +1,484 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef lobpcg_include_file
+#define lobpcg_include_file
+
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/lapack_full_matrix.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace dealii;
+
+/**
+ * Knyazev的局部最优块预条件共轭梯度法（LOBPCG），求广义特征值问题
+ * $Ax = \lambda Bx$ 的最小的几个特征值，A和B对称，B正定。
+ *
+ * 每一步在 $[X, W, P]$ 张成的子空间中做Rayleigh-Ritz投影，其中W是预条件
+ * 后的残差，P是上一步的搜索方向。已经收敛的向量不再产生新的搜索方向（软锁定）。
+ * W和P在投影之前与X B-正交，再用Cholesky-QR一起B-正交归一化，使小的Gram矩阵
+ * 接近单位矩阵。P几乎落在X和W张成的空间中时Cholesky分解失败，这时丢掉P，
+ * 从预条件最速下降重新开始。所有的内积在每一步中合并成几次全局归约。
+ *
+ * 收敛判据是最大的相对残差 $\|Ax_i - \lambda_i Bx_i\| / (|\lambda_i|
+ * \|Bx_i\|)$。`project`把向量投影到允许的子空间，例如把受约束的自由度置零。
+ *
+ * VectorType需要提供只遍历本地元素的begin()和end()，以及get_mpi_communicator()。
+ */
+template <typename VectorType>
+class SolverLOBPCG
+{
+public:
+  /**
+   * 构造函数。
+   */
+  SolverLOBPCG(SolverControl &solver_control)
+    : solver_control(solver_control)
+  {}
+
+  /**
+   * 求 $Ax = \lambda Bx$ 的最小的`eigenvectors.size()`个特征对。
+   * 输入的`eigenvectors`是线性无关的初始值，输出时是B-正交归一的特征向量。
+   */
+  template <typename MatrixType,
+            typename MassMatrixType,
+            typename PreconditionerType>
+  void
+  solve(const MatrixType &                       A,
+        const MassMatrixType &                   B,
+        const PreconditionerType &               preconditioner,
+        std::vector<double> &                    eigenvalues,
+        std::vector<VectorType> &                eigenvectors,
+        const std::function<void(VectorType &)> &project =
+          [](VectorType &) {});
+
+  /**
+   * 在`basis`张成的子空间中做Rayleigh-Ritz投影。`A_basis`和`B_basis`
+   * 是A和B作用在基上的结果。
+   *
+   * @param n_values 需要的Ritz值的个数，按从小到大的顺序。
+   * @param ritz_values 最小的`n_values`个Ritz值。
+   * @param coefficients 每一列是一个Ritz向量在基下的系数，B-正交归一。
+   */
+  static void
+  rayleigh_ritz(const std::vector<const VectorType *> &basis,
+                const std::vector<const VectorType *> &A_basis,
+                const std::vector<const VectorType *> &B_basis,
+                const unsigned int                     n_values,
+                std::vector<double> &                  ritz_values,
+                FullMatrix<double> &                   coefficients);
+
+  /**
+   * 用Cholesky-QR把`basis`变成B-正交归一的：Gram矩阵
+   * $G = V^T B V = R^T R$，然后 $V \leftarrow V R^{-1}$。`A_basis`和
+   * `B_basis`做同样的变换。
+   *
+   * @param tolerance 第j个向量到前面的向量张成的空间的B-距离的平方与它自己的
+   * B-范数的平方之比不能小于这个值。
+   * @return 如果G在这个意义下病态，返回false，并且不改变任何向量。
+   */
+  static bool
+  orthonormalize(const std::vector<VectorType *> &basis,
+                 const std::vector<VectorType *> &A_basis,
+                 const std::vector<VectorType *> &B_basis,
+                 const double                     tolerance);
+
+  /**
+   * 计算 $\sum_{l \ge first} c_{l,column} v_l$。
+   */
+  static void
+  combine(const std::vector<const VectorType *> &basis,
+          const FullMatrix<double> &             coefficients,
+          const unsigned int                     column,
+          const unsigned int                     first,
+          VectorType &                           result);
+
+  /**
+   * 用一次全局归约计算所有的 $(u_i, v_i)$。
+   */
+  static std::vector<double>
+  inner_products(
+    const std::vector<std::pair<const VectorType *, const VectorType *>>
+      &pairs);
+
+private:
+  SolverControl &solver_control;
+};
+
+
+
+template <typename VectorType>
+std::vector<double>
+SolverLOBPCG<VectorType>::inner_products(
+  const std::vector<std::pair<const VectorType *, const VectorType *>> &pairs)
+{
+  std::vector<double> local(pairs.size()), global(pairs.size());
+  if (pairs.empty())
+    return global;
+
+  for (unsigned int i = 0; i < pairs.size(); ++i)
+    {
+      auto iu = pairs[i].first->begin();
+      auto iv = pairs[i].second->begin();
+      for (; iu != pairs[i].first->end(); ++iu, ++iv)
+        local[i] += (*iu) * (*iv);
+    }
+  Utilities::MPI::sum(local,
+                      pairs[0].first->get_mpi_communicator(),
+                      global);
+  return global;
+}
+
+
+
+template <typename VectorType>
+void
+SolverLOBPCG<VectorType>::rayleigh_ritz(
+  const std::vector<const VectorType *> &basis,
+  const std::vector<const VectorType *> &A_basis,
+  const std::vector<const VectorType *> &B_basis,
+  const unsigned int                     n_values,
+  std::vector<double> &                  ritz_values,
+  FullMatrix<double> &                   coefficients)
+{
+  const unsigned int m = basis.size();
+  AssertDimension(A_basis.size(), m);
+  AssertDimension(B_basis.size(), m);
+  AssertIndexRange(n_values, m + 1);
+
+  // 两个Gram矩阵的上三角一起归约
+  std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+  for (unsigned int i = 0; i < m; ++i)
+    for (unsigned int j = i; j < m; ++j)
+      {
+        pairs.emplace_back(basis[i], A_basis[j]);
+        pairs.emplace_back(basis[i], B_basis[j]);
+      }
+  const auto gram = inner_products(pairs);
+
+  LAPACKFullMatrix<double> A_gram(m), B_gram(m);
+  unsigned int             k = 0;
+  for (unsigned int i = 0; i < m; ++i)
+    for (unsigned int j = i; j < m; ++j, k += 2)
+      {
+        A_gram(i, j) = A_gram(j, i) = gram[k];
+        B_gram(i, j) = B_gram(j, i) = gram[k + 1];
+      }
+
+  // LAPACK按从小到大的顺序返回特征值，特征向量B-正交归一
+  std::vector<Vector<double>> ritz_vectors(m, Vector<double>(m));
+  A_gram.compute_generalized_eigenvalues_symmetric(B_gram, ritz_vectors);
+
+  ritz_values.resize(n_values);
+  coefficients.reinit(m, n_values);
+  for (unsigned int i = 0; i < n_values; ++i)
+    {
+      ritz_values[i] = A_gram.eigenvalue(i).real();
+      for (unsigned int l = 0; l < m; ++l)
+        coefficients(l, i) = ritz_vectors[i](l);
+    }
+}
+
+
+
+template <typename VectorType>
+bool
+SolverLOBPCG<VectorType>::orthonormalize(
+  const std::vector<VectorType *> &basis,
+  const std::vector<VectorType *> &A_basis,
+  const std::vector<VectorType *> &B_basis,
+  const double                     tolerance)
+{
+  const unsigned int m = basis.size();
+  AssertDimension(A_basis.size(), m);
+  AssertDimension(B_basis.size(), m);
+
+  std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+  for (unsigned int i = 0; i < m; ++i)
+    for (unsigned int j = i; j < m; ++j)
+      pairs.emplace_back(basis[i], B_basis[j]);
+  const auto gram = inner_products(pairs);
+
+  FullMatrix<double> G(m, m);
+  unsigned int       k = 0;
+  for (unsigned int i = 0; i < m; ++i)
+    for (unsigned int j = i; j < m; ++j, ++k)
+      G(i, j) = G(j, i) = gram[k];
+
+  // G = R^T R，R是上三角的。对角元是第j个向量到前面的向量张成的空间的距离
+  FullMatrix<double> R(m, m);
+  for (unsigned int j = 0; j < m; ++j)
+    {
+      double diagonal = G(j, j);
+      for (unsigned int l = 0; l < j; ++l)
+        diagonal -= R(l, j) * R(l, j);
+      // 取反的比较也排除了NaN
+      if (!(diagonal > tolerance * G(j, j)))
+        return false;
+      R(j, j) = std::sqrt(diagonal);
+      for (unsigned int i = j + 1; i < m; ++i)
+        {
+          double value = G(j, i);
+          for (unsigned int l = 0; l < j; ++l)
+            value -= R(l, j) * R(l, i);
+          R(j, i) = value / R(j, j);
+        }
+    }
+
+  // V R^{-1}：按列前代，前面的列已经是新的向量
+  for (const auto *vectors : {&basis, &A_basis, &B_basis})
+    for (unsigned int j = 0; j < m; ++j)
+      {
+        for (unsigned int l = 0; l < j; ++l)
+          (*vectors)[j]->add(-R(l, j), *(*vectors)[l]);
+        *(*vectors)[j] *= 1. / R(j, j);
+      }
+  return true;
+}
+
+
+
+template <typename VectorType>
+void
+SolverLOBPCG<VectorType>::combine(
+  const std::vector<const VectorType *> &basis,
+  const FullMatrix<double> &             coefficients,
+  const unsigned int                     column,
+  const unsigned int                     first,
+  VectorType &                           result)
+{
+  result = 0;
+  for (unsigned int l = first; l < basis.size(); ++l)
+    result.add(coefficients(l, column), *basis[l]);
+}
+
+
+
+template <typename VectorType>
+template <typename MatrixType,
+          typename MassMatrixType,
+          typename PreconditionerType>
+void
+SolverLOBPCG<VectorType>::solve(
+  const MatrixType &                       A,
+  const MassMatrixType &                   B,
+  const PreconditionerType &               preconditioner,
+  std::vector<double> &                    eigenvalues,
+  std::vector<VectorType> &                eigenvectors,
+  const std::function<void(VectorType &)> &project)
+{
+  const unsigned int n = eigenvectors.size();
+  AssertThrow(n > 0, ExcMessage("At least one initial vector is needed."));
+
+  auto &                  X = eigenvectors;
+  std::vector<VectorType> AX(n, X[0]), BX(n, X[0]);
+  std::vector<VectorType> W(n, X[0]), AW(n, X[0]), BW(n, X[0]);
+  std::vector<VectorType> P(n, X[0]), AP(n, X[0]), BP(n, X[0]);
+  std::vector<VectorType> new_X(n, X[0]), new_AX(n, X[0]), new_BX(n, X[0]);
+  std::vector<VectorType> new_P(n, X[0]), new_AP(n, X[0]), new_BP(n, X[0]);
+
+  // 把X换成子空间S中的Ritz向量，新的P是其中不属于X的部分。
+  // 基中包含旧的X和P，所以结果先写到new_*中再交换
+  FullMatrix<double> coefficients;
+  auto update = [&](const std::vector<const VectorType *> &S,
+                    const std::vector<const VectorType *> &AS,
+                    const std::vector<const VectorType *> &BS) {
+    rayleigh_ritz(S, AS, BS, n, eigenvalues, coefficients);
+    for (unsigned int i = 0; i < n; ++i)
+      {
+        combine(S, coefficients, i, n, new_P[i]);
+        combine(AS, coefficients, i, n, new_AP[i]);
+        combine(BS, coefficients, i, n, new_BP[i]);
+        new_X[i]  = new_P[i];
+        new_AX[i] = new_AP[i];
+        new_BX[i] = new_BP[i];
+        for (unsigned int l = 0; l < n; ++l)
+          {
+            new_X[i].add(coefficients(l, i), *S[l]);
+            new_AX[i].add(coefficients(l, i), *AS[l]);
+            new_BX[i].add(coefficients(l, i), *BS[l]);
+          }
+      }
+    std::swap(X, new_X);
+    std::swap(AX, new_AX);
+    std::swap(BX, new_BX);
+    std::swap(P, new_P);
+    std::swap(AP, new_AP);
+    std::swap(BP, new_BP);
+  };
+
+  std::vector<const VectorType *> S, AS, BS;
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      project(X[i]);
+      A.vmult(AX[i], X[i]);
+      B.vmult(BX[i], X[i]);
+      S.push_back(&X[i]);
+      AS.push_back(&AX[i]);
+      BS.push_back(&BX[i]);
+    }
+  update(S, AS, BS);
+
+  std::vector<double>       residuals(n);
+  std::vector<unsigned int> active;
+  bool                      have_directions = false;
+
+  SolverControl::State state = SolverControl::iterate;
+  for (unsigned int it = 0;; ++it)
+    {
+      // 残差暂时存放在W中
+      std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+      for (unsigned int i = 0; i < n; ++i)
+        {
+          W[i] = AX[i];
+          W[i].add(-eigenvalues[i], BX[i]);
+          pairs.emplace_back(&W[i], &W[i]);
+          pairs.emplace_back(&BX[i], &BX[i]);
+        }
+      const auto norms = inner_products(pairs);
+
+      active.clear();
+      double max_residual = 0;
+      for (unsigned int i = 0; i < n; ++i)
+        {
+          const double scale =
+            std::abs(eigenvalues[i]) * std::sqrt(norms[2 * i + 1]);
+          residuals[i] = std::sqrt(norms[2 * i]) / (scale > 0 ? scale : 1.);
+          max_residual = std::max(max_residual, residuals[i]);
+          if (residuals[i] > solver_control.tolerance())
+            active.push_back(i);
+        }
+
+      state = solver_control.check(it, max_residual);
+      if (state != SolverControl::iterate)
+        break;
+
+      // 预条件后的残差W和搜索方向P都与X B-正交
+      const unsigned int n_per_pair = have_directions ? 2 : 1;
+      pairs.clear();
+      for (const auto i : active)
+        {
+          AW[i] = W[i];
+          preconditioner.vmult(W[i], AW[i]);
+          project(W[i]);
+          for (unsigned int j = 0; j < n; ++j)
+            {
+              pairs.emplace_back(&BX[j], &W[i]);
+              if (have_directions)
+                pairs.emplace_back(&BX[j], &P[i]);
+            }
+        }
+      const auto projections = inner_products(pairs);
+      for (unsigned int a = 0; a < active.size(); ++a)
+        for (unsigned int j = 0; j < n; ++j)
+          {
+            const auto i     = active[a];
+            const auto index = (a * n + j) * n_per_pair;
+            W[i].add(-projections[index], X[j]);
+            if (have_directions)
+              {
+                P[i].add(-projections[index + 1], X[j]);
+                AP[i].add(-projections[index + 1], AX[j]);
+                BP[i].add(-projections[index + 1], BX[j]);
+              }
+          }
+      for (const auto i : active)
+        {
+          A.vmult(AW[i], W[i]);
+          B.vmult(BW[i], W[i]);
+        }
+
+      // [W, P]一起B-正交归一化。Gram矩阵病态说明P几乎落在X和W张成的空间中，
+      // 这时丢掉P重新开始，否则Rayleigh-Ritz中的B_gram不再正定
+      std::vector<VectorType *> Q, AQ, BQ;
+      for (const auto i : active)
+        {
+          Q.push_back(&W[i]);
+          AQ.push_back(&AW[i]);
+          BQ.push_back(&BW[i]);
+        }
+      const double gram_tolerance = 1e-10;
+      if (have_directions)
+        {
+          for (const auto i : active)
+            {
+              Q.push_back(&P[i]);
+              AQ.push_back(&AP[i]);
+              BQ.push_back(&BP[i]);
+            }
+          if (!orthonormalize(Q, AQ, BQ, gram_tolerance))
+            {
+              have_directions = false;
+              Q.resize(active.size());
+              AQ.resize(active.size());
+              BQ.resize(active.size());
+            }
+        }
+      if (!have_directions)
+        {
+          const bool independent =
+            orthonormalize(Q, AQ, BQ, gram_tolerance);
+          AssertThrow(independent,
+                      ExcMessage("The preconditioned residuals are linearly "
+                                 "dependent on the current eigenvectors."));
+        }
+
+      S.clear();
+      AS.clear();
+      BS.clear();
+      for (unsigned int i = 0; i < n; ++i)
+        {
+          S.push_back(&X[i]);
+          AS.push_back(&AX[i]);
+          BS.push_back(&BX[i]);
+        }
+      for (const auto i : active)
+        {
+          S.push_back(&W[i]);
+          AS.push_back(&AW[i]);
+          BS.push_back(&BW[i]);
+        }
+      if (have_directions)
+        for (const auto i : active)
+          {
+            S.push_back(&P[i]);
+            AS.push_back(&AP[i]);
+            BS.push_back(&BP[i]);
+          }
+      update(S, AS, BS);
+      have_directions = true;
+    }
+
+  AssertThrow(state == SolverControl::success,
+              SolverControl::NoConvergence(solver_control.last_step(),
+                                           solver_control.last_value()));
+}
+
+#endif
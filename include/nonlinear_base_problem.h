@@ -0,0 +1,174 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef nonlinear_base_problem_include_file
+#define nonlinear_base_problem_include_file
+
+#include <deal.II/distributed/solution_transfer.h>
+
+#include <deal.II/lac/solver_gmres.h>
+
+#include "base_problem.h"
+
+using namespace dealii;
+
+/**
+ * 非线性问题 $R(u) = 0$ 的基类，用非精确Newton法和回溯线搜索求解。
+ *
+ * 派生类只需要在一个单元上计算残差和雅可比矩阵。系统的右端项是 $-R(u)$，
+ * 只组装残差时使用assemble_rhs()，矩阵和AMG预条件子保持不变。
+ *
+ * 在setup_system()之后，`solution`是满足Dirichlet边界条件的初始值，
+ * `constraints`是齐次的，只作用在Newton修正量上。
+ */
+template <int dim>
+class NonlinearBaseProblem : public BaseProblem<dim>
+{
+public:
+  /**
+   * 构造函数。初始化所有参数，包括基类，并确保该类可以运行。
+   */
+  NonlinearBaseProblem(const unsigned int &n_components = 1,
+                       const std::string & problem_name = "");
+
+  /**
+   * Virtual destructor.
+   */
+  virtual ~NonlinearBaseProblem() = default;
+
+  using CopyData    = typename BaseProblem<dim>::CopyData;
+  using ScratchData = typename BaseProblem<dim>::ScratchData;
+
+protected:
+  /**
+   * 在`scratch`当前的单元上计算残差 $R(u)$ 的局部向量。`scratch`中
+   * 已经用名字"solution"提取了当前迭代的局部自由度值。
+   */
+  virtual void
+  assemble_residual_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    Vector<double> &                                      cell_residual);
+
+  /**
+   * 在`scratch`当前的单元上计算雅可比矩阵 $R'(u)$ 的局部矩阵。
+   * 总是在assemble_residual_one_cell()之前调用。
+   */
+  virtual void
+  assemble_jacobian_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    FullMatrix<double> &                                  cell_jacobian);
+
+  /**
+   * 提取当前迭代的局部值，然后调用上面两个函数。
+   */
+  virtual void
+  assemble_system_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    CopyData &                                            copy) override;
+
+  /**
+   * 在基类的基础上设置满足边界条件的初始值，并把约束换成齐次的。网格加密之后，
+   * 初始值是从上一个循环转移过来的解，否则是边界值的提升。
+   */
+  virtual void
+  setup_system() override;
+
+  /**
+   * 细化网格，并准备把收敛的解转移到新的网格上，作为下一个循环中Newton迭代的
+   * 初始值。
+   */
+  virtual void
+  refine_grid() override;
+
+  /**
+   * Newton迭代。在run_refinement_cycles()中调用之前，雅可比矩阵和残差
+   * 已经在初始值上组装好了。
+   */
+  virtual void
+  solve() override;
+
+  /**
+   * Newton迭代的最大步数。
+   */
+  unsigned int max_newton_iterations = 50;
+
+  /**
+   * 残差的绝对和相对容限。
+   */
+  double newton_absolute_tolerance = 1e-10;
+  double newton_relative_tolerance = 1e-8;
+
+  /**
+   * 修正Newton法：在残差下降得足够快时重复使用雅可比矩阵和AMG。
+   */
+  bool modified_newton = false;
+
+  /**
+   * 一个雅可比矩阵最多使用的Newton步数。
+   */
+  unsigned int jacobian_reuse = 5;
+
+  /**
+   * 如果一步之后残差的比值大于这个值，则重新组装雅可比矩阵。
+   */
+  double jacobian_reuse_threshold = 0.5;
+
+  /**
+   * 线搜索中尝试的步长的最大个数。如果残差一直没有充分下降，而雅可比矩阵是
+   * 最新的，则抛出异常。
+   */
+  unsigned int max_line_search_steps = 10;
+
+  /**
+   * 内层的线性求解器："cg|gmres"。
+   */
+  std::string newton_linear_solver = "cg";
+
+  /**
+   * 内层求解的相对容限："eisenstat_walker|constant"。
+   */
+  std::string forcing_term_strategy = "eisenstat_walker";
+
+  /**
+   * 使用"constant"时的相对容限，以及Eisenstat-Walker容限的上界。
+   */
+  double constant_forcing_term = 1e-4;
+  double max_forcing_term      = 0.9;
+
+  /**
+   * 最近一次solve()中的Newton步数、组装的雅可比矩阵个数和线性迭代的总步数。
+   */
+  unsigned int n_newton_iterations = 0;
+  unsigned int n_jacobians         = 0;
+  unsigned int n_linear_iterations = 0;
+
+  /**
+   * refine_grid()中准备好、在下一次setup_system()中使用的解的转移。
+   */
+  std::unique_ptr<
+    parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector>>
+    solution_transfer;
+};
+
+#endif
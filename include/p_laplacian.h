@@ -0,0 +1,92 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef p_laplacian_include_file
+#define p_laplacian_include_file
+
+#include "nonlinear_base_problem.h"
+
+using namespace dealii;
+
+/**
+ * 正则化的p-Laplace问题
+ * $-\nabla\cdot((\varepsilon^2+|\nabla u|^2)^{(p-2)/2}\nabla u) = f$。
+ */
+template <int dim>
+class PLaplacian : public NonlinearBaseProblem<dim>
+{
+public:
+  /**
+   * 构造函数。初始化所有参数，包括基类，并确保该类可以运行。
+   */
+  PLaplacian();
+
+  /**
+   * 销毁p-Laplace对象
+   */
+  virtual ~PLaplacian() = default;
+
+  using CopyData    = typename BaseProblem<dim>::CopyData;
+  using ScratchData = typename BaseProblem<dim>::ScratchData;
+
+protected:
+  /**
+   * 局部残差，包括外力项和Neumann边界条件。
+   */
+  virtual void
+  assemble_residual_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    Vector<double> &                                      cell_residual)
+    override;
+
+  /**
+   * 局部雅可比矩阵。
+   */
+  virtual void
+  assemble_jacobian_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    FullMatrix<double> &                                  cell_jacobian)
+    override;
+
+  /**
+   * 强形式的残差
+   * $f + \nabla\cdot((\varepsilon^2+|\nabla u_h|^2)^{(p-2)/2}\nabla u_h)$。
+   */
+  virtual void
+  compute_strong_residual(
+    const FEValues<dim> &        fe_values,
+    const Vector<double> &       local_dof_values,
+    std::vector<Vector<double>> &residuals) const override;
+
+  /**
+   * 指数p。
+   */
+  double exponent = 3;
+
+  /**
+   * 正则化参数 $\varepsilon$，使得在 $\nabla u = 0$ 时雅可比矩阵仍然正定。
+   */
+  double regularization = 1e-2;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef p_laplacian_tester_h
+#define p_laplacian_tester_h
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "p_laplacian.h"
+
+using namespace dealii;
+
+//  p-Laplace问题的测试，使用积分常数
+template <class Integral>
+class PLaplacianTester : public ::testing::Test,
+                         public PLaplacian<Integral::value>
+{
+public:
+  PLaplacianTester() = default;
+};
+
+#endif
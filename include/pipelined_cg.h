@@ -0,0 +1,266 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+
+// Make sure we don't redefine things
+#ifndef pipelined_cg_include_file
+#define pipelined_cg_include_file
+
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/solver_control.h>
+
+#include <array>
+#include <cmath>
+
+using namespace dealii;
+
+/**
+ * Ghysels和Vanroose的流水线预条件共轭梯度法。
+ *
+ * 每一步只需要一次全局归约：三个内积 $(r,u)$、$(w,u)$ 和 $(r,r)$
+ * 被放在同一个MPI_Iallreduce中，并与预条件子和矩阵-向量乘积 $m=Mw$、$n=Am$
+ * 重叠进行。经典CG每一步有两次阻塞的归约。
+ *
+ * 如果`overlap_reductions`为假，则使用同样的递推公式，但归约是阻塞的。
+ * 这就是单归约（Chronopoulos-Gear）CG，即s=1时的s-step CG。
+ *
+ * 递推得到的残差会逐渐偏离真实残差。每隔`residual_replacement_interval`步
+ * 用真实残差替换递推量；如果出现 $\delta - \beta\gamma/\alpha \le 0$
+ * 的中断，则从真实残差重新开始；重新开始后立即中断时抛出异常。
+ *
+ * VectorType需要提供只遍历本地元素的begin()和end()，以及get_mpi_communicator()。
+ */
+template <typename VectorType>
+class SolverPipelinedCG
+{
+public:
+  /**
+   * 求解器的参数。
+   */
+  struct AdditionalData
+  {
+    AdditionalData(const bool         overlap_reductions            = true,
+                   const unsigned int residual_replacement_interval = 50)
+      : overlap_reductions(overlap_reductions)
+      , residual_replacement_interval(residual_replacement_interval)
+    {}
+
+    /**
+     * 是否用非阻塞的归约与预条件子和矩阵-向量乘积重叠。
+     */
+    bool overlap_reductions;
+
+    /**
+     * 每隔多少步用真实残差替换递推的残差。零表示从不替换。
+     */
+    unsigned int residual_replacement_interval;
+  };
+
+  /**
+   * 构造函数。
+   */
+  SolverPipelinedCG(SolverControl &       solver_control,
+                    const AdditionalData &data = AdditionalData())
+    : solver_control(solver_control)
+    , additional_data(data)
+  {}
+
+  /**
+   * 用预条件子`preconditioner`求解 $Ax=b$。`x`是初始值。
+   */
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  solve(const MatrixType &        A,
+        VectorType &              x,
+        const VectorType &        b,
+        const PreconditionerType &preconditioner);
+
+private:
+  /**
+   * 计算本地的 $(r,u)$、$(w,u)$ 和 $(r,r)$。
+   */
+  static std::array<double, 3>
+  local_dot_products(const VectorType &r,
+                     const VectorType &u,
+                     const VectorType &w);
+
+  SolverControl &solver_control;
+
+  const AdditionalData additional_data;
+};
+
+
+
+template <typename VectorType>
+std::array<double, 3>
+SolverPipelinedCG<VectorType>::local_dot_products(const VectorType &r,
+                                                  const VectorType &u,
+                                                  const VectorType &w)
+{
+  std::array<double, 3> dots = {{0, 0, 0}};
+
+  auto ir = r.begin();
+  auto iu = u.begin();
+  auto iw = w.begin();
+  for (; ir != r.end(); ++ir, ++iu, ++iw)
+    {
+      dots[0] += (*ir) * (*iu);
+      dots[1] += (*iw) * (*iu);
+      dots[2] += (*ir) * (*ir);
+    }
+  return dots;
+}
+
+
+
+template <typename VectorType>
+template <typename MatrixType, typename PreconditionerType>
+void
+SolverPipelinedCG<VectorType>::solve(const MatrixType &        A,
+                                     VectorType &              x,
+                                     const VectorType &        b,
+                                     const PreconditionerType &preconditioner)
+{
+  const MPI_Comm mpi_communicator = b.get_mpi_communicator();
+
+  VectorType r(b), u(b), w(b), m(b), n(b);
+  VectorType p(b), s(b), q(b), z(b);
+
+  // 用真实残差重新计算所有的递推量
+  auto replace_residual = [&](const bool restart) {
+    A.vmult(r, x);
+    r.sadd(-1., 1., b);
+    preconditioner.vmult(u, r);
+    A.vmult(w, u);
+    if (!restart)
+      {
+        A.vmult(s, p);
+        preconditioner.vmult(q, s);
+        A.vmult(z, q);
+      }
+  };
+
+  replace_residual(true);
+
+  double alpha = 0;
+  double gamma = 0;
+
+  bool restart = true;
+
+  SolverControl::State state = SolverControl::iterate;
+  for (unsigned int it = 0; state == SolverControl::iterate; ++it)
+    {
+      auto        dots    = local_dot_products(r, u, w);
+      MPI_Request request = MPI_REQUEST_NULL;
+      if (additional_data.overlap_reductions)
+        {
+          const int ierr = MPI_Iallreduce(MPI_IN_PLACE,
+                                          dots.data(),
+                                          dots.size(),
+                                          MPI_DOUBLE,
+                                          MPI_SUM,
+                                          mpi_communicator,
+                                          &request);
+          AssertThrowMPI(ierr);
+        }
+      else
+        {
+          const int ierr = MPI_Allreduce(MPI_IN_PLACE,
+                                         dots.data(),
+                                         dots.size(),
+                                         MPI_DOUBLE,
+                                         MPI_SUM,
+                                         mpi_communicator);
+          AssertThrowMPI(ierr);
+        }
+
+      // 与归约重叠的部分
+      preconditioner.vmult(m, w);
+      A.vmult(n, m);
+
+      if (additional_data.overlap_reductions)
+        {
+          const int ierr = MPI_Wait(&request, MPI_STATUS_IGNORE);
+          AssertThrowMPI(ierr);
+        }
+
+      state = solver_control.check(it, std::sqrt(std::abs(dots[2])));
+      if (state != SolverControl::iterate)
+        break;
+
+      const double gamma_new = dots[0];
+      const double delta     = dots[1];
+
+      double beta        = 0;
+      double denominator = delta;
+      if (!restart)
+        {
+          beta = gamma_new / gamma;
+          denominator -= beta * gamma_new / alpha;
+        }
+
+      if (!(denominator > 0) || !std::isfinite(gamma_new / denominator))
+        {
+          // 刚重新开始时中断说明预条件子或矩阵不是对称正定的，
+          // 否则是舍入误差积累得太多了，从真实残差重新开始
+          AssertThrow(!restart,
+                      SolverControl::NoConvergence(it,
+                                                   std::sqrt(
+                                                     std::abs(dots[2]))));
+          replace_residual(true);
+          restart = true;
+          continue;
+        }
+
+      alpha = gamma_new / denominator;
+      gamma = gamma_new;
+
+      if (restart)
+        {
+          z = n;
+          q = m;
+          s = w;
+          p = u;
+        }
+      else
+        {
+          z.sadd(beta, 1., n);
+          q.sadd(beta, 1., m);
+          s.sadd(beta, 1., w);
+          p.sadd(beta, 1., u);
+        }
+      restart = false;
+
+      x.add(alpha, p);
+      r.add(-alpha, s);
+      u.add(-alpha, q);
+      w.add(-alpha, z);
+
+      if (additional_data.residual_replacement_interval > 0 &&
+          (it + 1) % additional_data.residual_replacement_interval == 0)
+        replace_residual(false);
+    }
+
+  AssertThrow(state == SolverControl::success,
+              SolverControl::NoConvergence(solver_control.last_step(),
+                                           solver_control.last_value()));
+}
+
+#endif
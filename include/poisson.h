@@ -62,6 +62,70 @@ protected:
     ScratchData &                                         scratch,
     CopyData &                                            copy) override;
 
+  /**
+   * Assemble a batch of cells with one cell per lane of
+   * VectorizedArray<double>. FEValues are still evaluated cell by cell, but
+   * the quadrature loop for the local matrices runs on all lanes at once.
+   */
+  virtual void
+  assemble_system_batch(
+    const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+    ScratchData &                                                      scratch,
+    std::vector<CopyData> &                                            copies)
+    override;
+
+  /**
+   * Symmetric interior penalty terms on a Dirichlet boundary face, including
+   * the boundary data on the right hand side.
+   */
+  virtual void
+  assemble_boundary_face_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    const unsigned int                                    face_no,
+    ScratchData &                                         scratch,
+    CopyData &                                            copy) override;
+
+  /**
+   * Symmetric interior penalty terms on an interior face: consistency and
+   * symmetry terms built from averages and jumps, plus the penalty on jumps.
+   */
+  virtual void
+  assemble_interior_face(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    const unsigned int                                    face_no,
+    const unsigned int                                    subface_no,
+    const typename DoFHandler<dim>::active_cell_iterator &neighbor,
+    const unsigned int                                    neighbor_face_no,
+    const unsigned int                                    neighbor_subface_no,
+    ScratchData &                                         scratch,
+    typename BaseProblem<dim>::FaceCopyData &copy) override;
+
+  /**
+   * Assemble the right hand side, including Neumann terms, on a cell on which
+   * the scratch data has already been reinitialized.
+   */
+  void
+  assemble_rhs_one_cell(
+    const typename DoFHandler<dim>::active_cell_iterator &cell,
+    ScratchData &                                         scratch,
+    Vector<double> &                                      cell_rhs);
+
+  /**
+   * Strong residual f + div(a grad u_h) = f + a lap u_h + grad a . grad u_h,
+   * used by the residual and goal-oriented estimators.
+   */
+  virtual void
+  compute_strong_residual(
+    const FEValues<dim> &        fe_values,
+    const Vector<double> &       local_dof_values,
+    std::vector<Vector<double>> &residuals) const override;
+
+  /**
+   * The jumps of the normal flux are weighted by the coefficient a.
+   */
+  virtual const Function<dim> *
+  estimator_coefficient() const override;
+
   FunctionParser<dim> coefficient;
   std::string         coefficient_expression = "1";
   template <typename Integral>
@@ -66,6 +66,12 @@ protected:
   virtual void
   estimate() override;
 
+  /**
+   * 压力-压力块为零。由于对称梯度，速度的各个分量之间互相耦合。
+   */
+  virtual Table<2, DoFTools::Coupling>
+  coupling_table() const override;
+
   /**
    * 在装配程序中使用的提取器。
    */
@@ -0,0 +1,20 @@
+#ifndef stokes_tester_h
+#define stokes_tester_h
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "stokes.h"
+
+using namespace dealii;
+
+//  斯托克斯问题的测试，使用积分常数
+template <class Integral>
+class StokesTester : public ::testing::Test, public Stokes<Integral::value>
+{
+public:
+  StokesTester() = default;
+};
+
+#endif
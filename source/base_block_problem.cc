@@ -29,7 +29,10 @@ BaseBlockProblem<dim>::BaseBlockProblem(
   const std::string &            problem_name)
   : BaseProblem<dim>(component_names.size(), problem_name)
   , component_names(component_names)
-{}
+{
+  // 误差按分量名称分组计算，例如Stokes问题中的u和p
+  this->error_component_names = component_names;
+}
 
 
 
@@ -38,11 +41,14 @@ void
 BaseBlockProblem<dim>::setup_system()
 {
   TimerOutput::Scope timer_section(this->timer, "setup_system");
+  AssertThrow(this->n_load_cases() == 0,
+              ExcMessage("Load cases are only supported by BaseProblem."));
   if (!this->fe) // this 其作用就是指向成员函数所作用的对象
     {
       this->fe = FETools::get_fe_by_name<dim>(this->fe_name);
-      this->mapping =
-        std::make_unique<MappingQGeneric<dim>>(this->mapping_degree);
+      this->assembly_scratch.reset();
+      this->cached_dirichlet_boundary_condition.reset();
+      this->create_mapping();
       const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
       this->forcing_term.initialize(vars,
                                     this->forcing_term_expression,
@@ -58,8 +64,18 @@ BaseBlockProblem<dim>::setup_system()
         vars, this->neumann_boundary_conditions_expression, this->constants);
     }
 
+  AssertThrow(!this->use_hp,
+              ExcMessage("hp refinement is only supported by BaseProblem."));
+  AssertThrow(!this->is_dg(),
+              ExcMessage("Discontinuous Galerkin assembly is only supported "
+                         "by BaseProblem."));
+  this->fe_collection = hp::FECollection<dim>(*this->fe);
+  this->update_mapping_cache();
   this->dof_handler.distribute_dofs(*this->fe);
 
+  // 先按所选的策略编号，再按块编号。component_wise保持块内的相对顺序。
+  this->renumber_dofs();
+
   // 以顺时针的方式重新编号Dofs。
   std::vector<unsigned int> blocks(this->n_components);
   unsigned int              i = 0;
@@ -92,17 +108,7 @@ BaseBlockProblem<dim>::setup_system()
               << std::endl;
 
 
-  this->constraints.clear();
-  this->constraints.reinit(non_blocked_locally_relevant_dofs);
-  DoFTools::make_hanging_node_constraints(this->dof_handler, this->constraints);
-
-  for (const auto &id : this->dirichlet_ids)
-    VectorTools::interpolate_boundary_values(*this->mapping,
-                                             this->dof_handler,
-                                             id,
-                                             this->dirichlet_boundary_condition,
-                                             this->constraints);
-  this->constraints.close();
+  this->make_constraints(non_blocked_locally_relevant_dofs);
 
 
   TrilinosWrappers::BlockSparsityPattern dsp(locally_owned_dofs,
@@ -111,6 +117,7 @@ BaseBlockProblem<dim>::setup_system()
                                              this->mpi_communicator);
 
   DoFTools::make_sparsity_pattern(this->dof_handler,
+                                  coupling_table(),
                                   dsp,
                                   this->constraints,
                                   false);
@@ -167,22 +174,20 @@ void
 BaseBlockProblem<dim>::assemble_system()
 {
   TimerOutput::Scope timer_section(this->timer, "assemble_system");
-  QGauss<dim>        quadrature_formula(this->fe->degree + 1);
-  QGauss<dim - 1>    face_quadrature_formula(this->fe->degree + 1);
-
-  ScratchData scratch(*this->mapping,
-                      *this->fe,
-                      quadrature_formula,
-                      update_values | update_gradients |
-                        update_quadrature_points | update_JxW_values,
-                      face_quadrature_formula,
-                      update_values | update_quadrature_points |
-                        update_JxW_values);
+  auto &scratch_pool = this->get_assembly_scratch();
 
   CopyData copy(this->fe->n_dofs_per_cell());
 
-  auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
-    assemble_system_one_cell(cell, scratch, copy);
+  // WorkStream自己的scratch参数不用：ScratchData取自线程局部的池
+  auto worker = [&](const auto &cell, unsigned int &, auto &copy) {
+#ifdef DEBUG
+    const auto n_allocations = n_thread_local_allocations();
+#endif
+    assemble_system_one_cell(cell, scratch_pool.get()[0], copy);
+#ifdef DEBUG
+    this->n_assembly_allocations +=
+      n_thread_local_allocations() - n_allocations;
+#endif
   };
 
   auto copier = [&](const auto &copy) { copy_one_cell(copy); };
@@ -196,7 +201,7 @@ BaseBlockProblem<dim>::assemble_system()
                              this->dof_handler.end()),
                   worker,
                   copier,
-                  scratch,
+                  0u,
                   copy);
 
   system_block_matrix.compress(VectorOperation::add);
@@ -220,6 +225,85 @@ BaseBlockProblem<dim>::solve()
 
 
 
+template <int dim>
+Table<2, DoFTools::Coupling>
+BaseBlockProblem<dim>::coupling_table() const
+{
+  return Table<2, DoFTools::Coupling>(this->n_components,
+                                      this->n_components,
+                                      DoFTools::always);
+}
+
+
+
+template <int dim>
+void
+BaseBlockProblem<dim>::diagnostics(const unsigned int cycle)
+{
+  this->write_diagnostics(locally_relevant_block_solution, cycle);
+}
+
+
+
+template <int dim>
+types::global_dof_index
+BaseBlockProblem<dim>::matrix_bandwidth() const
+{
+  // 块内的行号和列号加上块的偏移量就是全局编号
+  std::vector<types::global_dof_index> offsets(dofs_per_block.size(), 0);
+  for (unsigned int b = 1; b < dofs_per_block.size(); ++b)
+    offsets[b] = offsets[b - 1] + dofs_per_block[b - 1];
+
+  types::global_dof_index bandwidth = 0;
+  for (unsigned int i = 0; i < system_block_matrix.n_block_rows(); ++i)
+    for (unsigned int j = 0; j < system_block_matrix.n_block_cols(); ++j)
+      {
+        const auto &block = system_block_matrix.block(i, j);
+        for (const auto row : locally_owned_dofs[i])
+          for (auto entry = block.begin(row); entry != block.end(row); ++entry)
+            {
+              const auto global_row    = offsets[i] + row;
+              const auto global_column = offsets[j] + entry->column();
+              bandwidth                = std::max<types::global_dof_index>(
+                bandwidth,
+                global_column > global_row ? global_column - global_row :
+                                             global_row - global_column);
+            }
+      }
+  return Utilities::MPI::max(bandwidth, this->mpi_communicator);
+}
+
+
+
+template <int dim>
+void
+BaseBlockProblem<dim>::print_matrix_statistics()
+{
+  const unsigned int n_repetitions = 10;
+
+  LA::MPI::BlockVector src(system_block_rhs);
+  LA::MPI::BlockVector dst(system_block_rhs);
+  src = 1.0;
+
+  Timer spmv_timer(this->mpi_communicator, true);
+  for (unsigned int i = 0; i < n_repetitions; ++i)
+    system_block_matrix.vmult(dst, src);
+  spmv_timer.stop();
+
+  const double memory =
+    Utilities::MPI::sum(system_block_matrix.memory_consumption() / 1048576.,
+                        this->mpi_communicator);
+
+  this->pcout << "DoF renumbering: " << this->dof_renumbering
+              << ", matrix bandwidth: " << this->matrix_bandwidth()
+              << ", nonzeros: " << system_block_matrix.n_nonzero_elements()
+              << ", matrix memory: " << memory << "MB"
+              << ", SpMV time: " << spmv_timer.wall_time() / n_repetitions
+              << "s" << std::endl;
+}
+
+
+
 template class BaseBlockProblem<1>;
 template class BaseBlockProblem<2>;
 template class BaseBlockProblem<3>;
\ No newline at end of file
@@ -19,10 +19,36 @@
  */
 #include "base_problem.h"
 
+#include "pipelined_cg.h"
+
+#include <deal.II/fe/fe_tools_interpolate.h>
+
+#include <deal.II/matrix_free/matrix_free.h>
+
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif
 
 
 using namespace dealii;
 
+#ifdef DEBUG
+std::size_t (*thread_local_allocation_counter)() = nullptr;
+
+
+
+std::size_t
+n_thread_local_allocations()
+{
+  return thread_local_allocation_counter ? thread_local_allocation_counter() :
+                                           0;
+}
+#endif
+
 template <int dim>
 BaseProblem<dim>::BaseProblem(const unsigned int &n_components,
                               const std::string & problem_name)
@@ -36,26 +62,54 @@ BaseProblem<dim>::BaseProblem(const unsigned int &n_components,
                     Triangulation<dim>::smoothing_on_refinement |
                     Triangulation<dim>::smoothing_on_coarsening))
   , dof_handler(triangulation)
+  , dual_dof_handler(triangulation)
   , forcing_term(n_components)                 // 初始化为矢量形式
   , exact_solution(n_components)               // 初始化为矢量形式
   , dirichlet_boundary_condition(n_components) // 初始化为矢量形式
   , neumann_boundary_condition(n_components)   // 初始化为矢量形式
-  , error_table(std::vector<std::string>(n_components, "u"))
+  , error_component_names(n_components, "u")
+  , error_table(error_component_names,
+                std::vector<std::set<VectorTools::NormType>>(1))
   , solver_control("/Solver control", 1000, 1e-12, 1e-12)
+  , startup_timer(mpi_communicator, true)
 {
   TimerOutput::Scope timer_section(timer, "constructor");
   add_parameter("Finite element space", fe_name);
   add_parameter("Mapping degree", mapping_degree);
+  add_parameter("Cache mapping", cache_mapping);
   add_parameter("Number of global refinements", n_refinements);
   add_parameter("Output filename", output_filename);
+  add_parameter("Output format",
+                output_format,
+                "",
+                this->prm,
+                Patterns::Selection("vtu|none"));
   add_parameter("Forcing term expression", forcing_term_expression);
   add_parameter("Dirichlet boundary condition expression",
                 dirichlet_boundary_conditions_expression);
   add_parameter("Number of threads", number_of_threads);
+  add_parameter("Pin threads to cores", pin_threads);
   add_parameter("Exact solution expression", exact_solution_expression);
   add_parameter("Neumann boundary condition expression",
                 neumann_boundary_conditions_expression);
 
+  add_parameter("Load case forcing term expressions",
+                load_case_forcing_term_expressions,
+                "",
+                this->prm,
+                Patterns::List(Patterns::Anything(),
+                               0,
+                               Patterns::List::max_int_value,
+                               "|"));
+  add_parameter("Load case Neumann boundary condition expressions",
+                load_case_neumann_boundary_conditions_expressions,
+                "",
+                this->prm,
+                Patterns::List(Patterns::Anything(),
+                               0,
+                               Patterns::List::max_int_value,
+                               "|"));
+
   add_parameter("Local pre-refinement grid size expression",
                 pre_refinement_expression);
 
@@ -65,13 +119,29 @@ BaseProblem<dim>::BaseProblem(const unsigned int &n_components,
   add_parameter("Problem constants", constants);
   add_parameter("Grid generator function", grid_generator_function);
   add_parameter("Grid generator arguments", grid_generator_arguments);
+  add_parameter("Grid input file", grid_input_file);
+  add_parameter("Mesh cache directory", mesh_cache_directory);
   add_parameter("Number of refinement cycles", n_refinement_cycles);
 
   add_parameter("Estimator type",
                 estimator_type,
                 "",
                 this->prm,
-                Patterns::Selection("exact|kelly|residual"));
+                Patterns::Selection("exact|kelly|residual|dwr"));
+
+  enter_subsection("Goal functional");
+  {
+    add_parameter("Functional",
+                  goal_functional,
+                  "",
+                  this->prm,
+                  Patterns::Selection(
+                    "point_value|domain_integral|boundary_integral"));
+    add_parameter("Evaluation point", goal_point);
+    add_parameter("Boundary ids", goal_boundary_ids);
+    add_parameter("Component", goal_component);
+  }
+  leave_subsection();
 
   add_parameter("Marking strategy",
                 marking_strategy,
@@ -82,9 +152,126 @@ BaseProblem<dim>::BaseProblem(const unsigned int &n_components,
   add_parameter("Coarsening and refinement factors",
                 coarsening_and_refinement_factors);
 
+  add_parameter("Use hp refinement", use_hp);
+  add_parameter("Maximum polynomial degree", max_degree);
+  add_parameter("Smoothness estimator",
+                smoothness_estimator,
+                "",
+                this->prm,
+                Patterns::Selection("legendre|fourier"));
+  add_parameter("p-refinement and coarsening fractions",
+                p_refinement_and_coarsening_fractions);
+
+  downstream_direction[0] = 1;
+  add_parameter("DoF renumbering",
+                dof_renumbering,
+                "",
+                this->prm,
+                Patterns::Selection("none|cuthill_mckee|hierarchical|"
+                                    "matrix_free_data_locality|downstream"));
+  add_parameter("Downstream direction", downstream_direction);
+  add_parameter("Report matrix statistics", report_matrix_statistics);
+  add_parameter("Batched assembly", batched_assembly);
+  add_parameter("DG penalty", dg_penalty);
+  add_parameter("DG preconditioner",
+                dg_preconditioner,
+                "",
+                this->prm,
+                Patterns::Selection("amg|block_jacobi"));
+  add_parameter("Cache boundary values", cache_boundary_values);
+
+  add_parameter("Use direct solver", use_direct_solver);
+  add_parameter("Direct solver dofs threshold", direct_solver_dofs_threshold);
+  add_parameter("Direct solver type",
+                direct_solver_type,
+                "",
+                this->prm,
+                Patterns::Selection("Amesos_Lapack|Amesos_Scalapack|"
+                                    "Amesos_Klu|Amesos_Umfpack|"
+                                    "Amesos_Pardiso|Amesos_Taucs|"
+                                    "Amesos_Superlu|Amesos_Superludist|"
+                                    "Amesos_Dscpack|Amesos_Mumps"));
+
+  add_parameter("Linear algebra backend",
+                linear_algebra_backend,
+                "",
+                this->prm,
+                Patterns::Selection("trilinos|native"));
+  add_parameter("Native preconditioner",
+                native_preconditioner,
+                "",
+                this->prm,
+                Patterns::Selection("ssor|jacobi|chebyshev"));
+  add_parameter("Iterative solver",
+                iterative_solver,
+                "",
+                this->prm,
+                Patterns::Selection("cg|pipelined_cg|single_reduction_cg"));
+  add_parameter("Residual replacement interval",
+                residual_replacement_interval);
+  add_parameter("Report solver statistics", report_solver_statistics);
+
+  enter_subsection("Preconditioner");
+  {
+    add_parameter("Elliptic", amg_elliptic);
+    add_parameter("Higher order elements", amg_higher_order_elements);
+    add_parameter("Number of cycles", amg_n_cycles);
+    add_parameter("W-cycle", amg_w_cycle);
+    add_parameter("Aggregation threshold", amg_aggregation_threshold);
+    add_parameter("Smoother sweeps", amg_smoother_sweeps);
+    add_parameter("Smoother overlap", amg_smoother_overlap);
+    add_parameter("Smoother type",
+                  amg_smoother_type,
+                  "",
+                  this->prm,
+                  Patterns::Selection("Aztec|IFPACK|Jacobi|ML symmetric "
+                                      "Gauss-Seidel|symmetric Gauss-Seidel|"
+                                      "ML Gauss-Seidel|Gauss-Seidel|"
+                                      "block Gauss-Seidel|symmetric block "
+                                      "Gauss-Seidel|Chebyshev|MLS|Hiptmair|"
+                                      "Amesos-KLU|Amesos-Superlu|"
+                                      "Amesos-UMFPACK|Amesos-Superludist|"
+                                      "Amesos-MUMPS|user-defined|SuperLU|"
+                                      "IFPACK-Chebyshev|self|do-nothing|"
+                                      "IC|ICT|ILU|ILUT|Block Chebyshev|"
+                                      "IFPACK-Block Chebyshev"));
+    add_parameter("Coarse type",
+                  amg_coarse_type,
+                  "",
+                  this->prm,
+                  Patterns::Selection("Amesos-KLU|Amesos-Superlu|"
+                                      "Amesos-UMFPACK|Amesos-Superludist|"
+                                      "Amesos-MUMPS|Chebyshev|"
+                                      "symmetric Gauss-Seidel|Jacobi|"
+                                      "IFPACK|ILU|ILUT|IC|ICT"));
+    add_parameter("Use component constant modes",
+                  amg_component_constant_modes);
+  }
+  leave_subsection();
+
+  enter_subsection("Diagnostics");
+  {
+    add_parameter("Probe points", probe_points);
+    add_parameter("Polylines", polylines);
+    add_parameter("Points per polyline segment", points_per_polyline_segment);
+    add_parameter("Boundary integral ids", boundary_integral_ids);
+    add_parameter("Diagnostics filename", diagnostics_filename);
+  }
+  leave_subsection();
+
+  add_parameter("Error norms", error_norms);
+
   this->prm.enter_subsection("Error table");
   error_table.add_parameters(this->prm);
+  default_error_table_norms =
+    this->prm.get("List of error norms to compute");
   this->prm.leave_subsection();
+
+  // 网格的任何改变都使缓存的映射支撑点失效
+  mapping_cache_connection = triangulation.signals.any_change.connect(
+    [this]() { mapping_cache_is_current = false; });
+  diagnostic_evaluation_connection = triangulation.signals.any_change.connect(
+    [this]() { diagnostic_evaluation_is_current = false; });
 }
 
 
@@ -96,6 +283,93 @@ BaseProblem<dim>::initialize(const std::string &filename)
   ParameterAcceptor::initialize(filename,
                                 "last_used_parameters.prm",
                                 ParameterHandler::Short);
+  configure_threads();
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::configure_threads()
+{
+  // 同一个节点上的进程共享内存，用它们的个数平分节点上的核
+  MPI_Comm  node_communicator;
+  const int ierr =
+    MPI_Comm_split_type(mpi_communicator,
+                        MPI_COMM_TYPE_SHARED,
+                        Utilities::MPI::this_mpi_process(mpi_communicator),
+                        MPI_INFO_NULL,
+                        &node_communicator);
+  AssertThrowMPI(ierr);
+  const unsigned int ranks_per_node =
+    Utilities::MPI::n_mpi_processes(node_communicator);
+  const unsigned int node_rank =
+    Utilities::MPI::this_mpi_process(node_communicator);
+
+  // 这个进程可以使用的核。在Linux上是继承的cpuset，其中已经包含了作业调度器
+  // 或mpirun的绑定。
+  std::vector<unsigned int> allowed_cores;
+#ifdef __linux__
+  cpu_set_t inherited_cpu_set;
+  CPU_ZERO(&inherited_cpu_set);
+  AssertThrow(sched_getaffinity(0,
+                                sizeof(inherited_cpu_set),
+                                &inherited_cpu_set) == 0,
+              ExcMessage("Could not query the CPU affinity of this process."));
+  for (unsigned int core = 0; core < CPU_SETSIZE; ++core)
+    if (CPU_ISSET(core, &inherited_cpu_set))
+      allowed_cores.push_back(core);
+#else
+  for (unsigned int core = 0; core < MultithreadInfo::n_cores(); ++core)
+    allowed_cores.push_back(core);
+#endif
+
+  // 继承了同一组核的进程平分这些核。启动器已经把每个进程绑定到各自的核上时，
+  // 每组只有一个进程。
+  const auto all_allowed_cores =
+    Utilities::MPI::all_gather(node_communicator, allowed_cores);
+  Utilities::MPI::free_communicator(node_communicator);
+  unsigned int n_sharing_ranks = 0;
+  unsigned int sharing_rank    = 0;
+  for (unsigned int rank = 0; rank < all_allowed_cores.size(); ++rank)
+    if (all_allowed_cores[rank] == allowed_cores)
+      {
+        if (rank < node_rank)
+          ++sharing_rank;
+        ++n_sharing_ranks;
+      }
+
+  const unsigned int n_cores = allowed_cores.size();
+  const unsigned int n_threads =
+    number_of_threads > 0 ? static_cast<unsigned int>(number_of_threads) :
+                            std::max(n_cores / n_sharing_ranks, 1u);
+  MultithreadInfo::set_thread_limit(n_threads);
+
+  const unsigned int first_core = (sharing_rank * n_threads) % n_cores;
+#ifdef __linux__
+  // 相邻编号的核通常属于同一个NUMA域。TBB的工作线程在第一次并行任务时才创建，
+  // 所以它们会继承这里设置的亲和性。
+  if (pin_threads)
+    {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      for (unsigned int i = 0; i < n_threads; ++i)
+        CPU_SET(allowed_cores[(first_core + i) % n_cores], &cpu_set);
+      AssertThrow(sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0,
+                  ExcMessage("Could not pin the threads of this process."));
+    }
+#else
+  AssertThrow(!pin_threads,
+              ExcMessage("Pinning threads is only supported on Linux."));
+#endif
+
+  pcout << "Hybrid layout          : " << ranks_per_node
+        << " processes per node x " << n_threads << " threads on " << n_cores
+        << " allowed cores";
+  if (pin_threads)
+    pcout << ", process k pinned to allowed cores [k*" << n_threads
+          << ", (k+1)*" << n_threads << ")";
+  pcout << std::endl;
 }
 
 
@@ -111,6 +385,32 @@ BaseProblem<dim>::parse_string(const std::string &parameters)
 
 
 
+template <int dim>
+void
+BaseProblem<dim>::parse_parameters(ParameterHandler &prm)
+{
+  ParameterAcceptor::parse_parameters(prm);
+
+  // "Error table"在顶层声明，而这里处在本类的小节中
+  this->leave_my_subsection(prm);
+  prm.enter_subsection("Error table");
+  const auto norms = prm.get("List of error norms to compute");
+  if (norms != default_error_table_norms)
+    {
+      for (const auto &component : Utilities::split_string_list(norms, ';'))
+        for (const auto &norm : Utilities::split_string_list(component, ','))
+          if (!norm.empty() && norm != "none")
+            error_norms.insert(
+              Patterns::Tools::Convert<VectorTools::NormType>::to_value(
+                norm));
+      prm.set("List of error norms to compute", default_error_table_norms);
+    }
+  prm.leave_subsection();
+  this->enter_my_subsection(prm);
+}
+
+
+
 template <int dim>
 void
 BaseProblem<dim>::make_grid()
@@ -119,16 +419,54 @@ BaseProblem<dim>::make_grid()
 
   const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
   pre_refinement.initialize(vars, pre_refinement_expression, constants);
-  GridGenerator::generate_from_name_and_arguments(triangulation,
-                                                  grid_generator_function,
-                                                  grid_generator_arguments);
+  if (grid_input_file.empty())
+    GridGenerator::generate_from_name_and_arguments(triangulation,
+                                                    grid_generator_function,
+                                                    grid_generator_arguments);
+  else
+    read_grid();
+
+  // load()需要相同的粗网格，所以只有预加密的部分可以缓存。
+  // 完整的键保存在缓存旁边，读入前核对，以排除哈希冲突和过时的缓存。
+  // 不使用缓存时不计算键，以免再读一遍网格文件。
+  const std::string cache_key =
+    mesh_cache_directory.empty() ? "" : mesh_cache_key();
+  const std::string cache_filename = mesh_cache_filename(cache_key);
+  bool              cache_hit      = false;
+  if (!cache_filename.empty())
+    {
+      if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+        {
+          std::ifstream key_file(cache_filename + ".key");
+          std::string   stored_key;
+          std::getline(key_file, stored_key);
+          cache_hit = std::ifstream(cache_filename + ".info") &&
+                      key_file && stored_key == cache_key;
+        }
+      cache_hit = Utilities::MPI::broadcast(mpi_communicator, cache_hit);
+    }
 
-  for (unsigned int i = 0; i < n_refinements; ++i)
+  if (cache_hit)
     {
-      for (const auto &cell : triangulation.active_cell_iterators())
-        if (pre_refinement.value(cell->center()) < cell->diameter())
-          cell->set_refine_flag();
-      triangulation.execute_coarsening_and_refinement();
+      // 进程数与保存时不同时，p4est会重新划分网格
+      triangulation.load(cache_filename);
+      pcout << "Loaded mesh from cache " << cache_filename << std::endl;
+    }
+  else
+    {
+      for (unsigned int i = 0; i < n_refinements; ++i)
+        {
+          for (const auto &cell : triangulation.active_cell_iterators())
+            if (pre_refinement.value(cell->center()) < cell->diameter())
+              cell->set_refine_flag();
+          triangulation.execute_coarsening_and_refinement();
+        }
+      if (!cache_filename.empty())
+        {
+          triangulation.save(cache_filename);
+          if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+            std::ofstream(cache_filename + ".key") << cache_key << std::endl;
+        }
     }
 
   pcout << "Number of active cells: " << triangulation.n_active_cells()
@@ -137,6 +475,102 @@ BaseProblem<dim>::make_grid()
 
 
 
+namespace
+{
+  /**
+   * 64位FNV-1a哈希。与std::hash不同，它的结果不依赖于编译器和标准库，
+   * 可以作为不同构建之间共享的缓存文件名。
+   */
+  std::uint64_t
+  fnv1a_hash(const std::string &data)
+  {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char c : data)
+      {
+        hash ^= c;
+        hash *= 1099511628211ull;
+      }
+    return hash;
+  }
+} // namespace
+
+
+
+template <int dim>
+std::string
+BaseProblem<dim>::mesh_cache_key() const
+{
+  // 进程数不属于键：p::d::Triangulation可以在不同的进程数下load()
+  std::string key =
+    grid_generator_function + "|" + grid_generator_arguments + "|" +
+    grid_input_file + "|" + pre_refinement_expression + "|" +
+    Patterns::Tools::to_string(constants) + "|" +
+    std::to_string(n_refinements) + "|" + std::to_string(dim);
+
+  // 网格文件的内容改变时，文件名相同的缓存也不再有效
+  if (!grid_input_file.empty())
+    {
+      std::uint64_t content_hash = 0;
+      if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+        {
+          std::ifstream     file(grid_input_file);
+          std::stringstream content;
+          content << file.rdbuf();
+          content_hash = fnv1a_hash(content.str());
+        }
+      key += "|" + std::to_string(
+                     Utilities::MPI::broadcast(mpi_communicator, content_hash));
+    }
+  return key;
+}
+
+
+
+template <int dim>
+std::string
+BaseProblem<dim>::mesh_cache_filename(const std::string &key) const
+{
+  if (mesh_cache_directory.empty())
+    return "";
+
+  std::stringstream name;
+  name << mesh_cache_directory << "/mesh_" << std::hex << std::setw(16)
+       << std::setfill('0') << fnv1a_hash(key);
+  return name.str();
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::read_grid()
+{
+  std::vector<Point<dim>>    vertices;
+  std::vector<CellData<dim>> cells;
+  SubCellData                subcell_data;
+
+  // 串行网格在这个作用域结束时释放，0号进程上不会同时保存串行网格和分布式网格
+  if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+    {
+      Triangulation<dim> serial_triangulation;
+      GridIn<dim>        grid_in(serial_triangulation);
+      grid_in.read(grid_input_file);
+      std::tie(vertices, cells, subcell_data) =
+        GridTools::get_coarse_mesh_description(serial_triangulation);
+    }
+
+  vertices = Utilities::MPI::broadcast(mpi_communicator, vertices);
+  cells    = Utilities::MPI::broadcast(mpi_communicator, cells);
+  subcell_data.boundary_lines =
+    Utilities::MPI::broadcast(mpi_communicator, subcell_data.boundary_lines);
+  subcell_data.boundary_quads =
+    Utilities::MPI::broadcast(mpi_communicator, subcell_data.boundary_quads);
+
+  triangulation.create_triangulation(vertices, cells, subcell_data);
+}
+
+
+
 template <int dim>
 void
 BaseProblem<dim>::refine_grid()
@@ -148,6 +582,36 @@ BaseProblem<dim>::refine_grid()
 
 
 
+template <int dim>
+void
+BaseProblem<dim>::create_mapping()
+{
+  // 定位结果引用旧的映射，必须在它之前释放
+  diagnostic_evaluation.reset();
+  if (cache_mapping)
+    mapping = std::make_unique<MappingQCache<dim>>(mapping_degree);
+  else
+    mapping = std::make_unique<MappingQGeneric<dim>>(mapping_degree);
+  mapping_cache_is_current = false;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::update_mapping_cache()
+{
+  if (!cache_mapping || mapping_cache_is_current)
+    return;
+
+  TimerOutput::Scope timer_section(timer, "mapping_cache");
+  auto &cache = dynamic_cast<MappingQCache<dim> &>(*mapping);
+  cache.initialize(MappingQGeneric<dim>(mapping_degree), triangulation);
+  mapping_cache_is_current = true;
+}
+
+
+
 template <int dim>
 void
 BaseProblem<dim>::setup_system()
@@ -155,20 +619,54 @@ BaseProblem<dim>::setup_system()
   TimerOutput::Scope timer_section(timer, "setup_system");
   if (!fe)
     {
-      fe              = FETools::get_fe_by_name<dim>(fe_name);
-      mapping         = std::make_unique<MappingQGeneric<dim>>(mapping_degree);
-      const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
-      forcing_term.initialize(vars, forcing_term_expression, constants);
-      exact_solution.initialize(vars, exact_solution_expression, constants);
-
-      dirichlet_boundary_condition.initialize(
-        vars, dirichlet_boundary_conditions_expression, constants);
+      fe = FETools::get_fe_by_name<dim>(fe_name);
+      create_mapping();
+      initialize_functions();
+
+      legendre.reset();
+      fourier.reset();
+      assembly_scratch.reset();
+      cached_dirichlet_boundary_condition.reset();
+      if (use_hp)
+        {
+          AssertThrow(n_components == 1,
+                      ExcMessage("hp refinement is only implemented for "
+                                 "scalar problems."));
+          AssertThrow(fe->degree >= 1 && fe->degree <= max_degree,
+                      ExcMessage("The degree of the finite element space "
+                                 "must be between 1 and the maximum "
+                                 "polynomial degree."));
+          fe_collection = hp::FECollection<dim>();
+          for (unsigned int degree = 1; degree <= max_degree; ++degree)
+            fe_collection.push_back(FE_Q<dim>(degree));
+
+          // 从参数文件中给定的次数开始
+          for (const auto &cell : dof_handler.active_cell_iterators())
+            if (cell->is_locally_owned())
+              cell->set_active_fe_index(fe->degree - 1);
+
+          cell_weights = std::make_unique<parallel::CellWeights<dim>>(
+            dof_handler, parallel::CellWeights<dim>::ndofs_weighting({1, 1}));
+        }
+      else
+        {
+          fe_collection = hp::FECollection<dim>(*fe);
+          cell_weights.reset();
 
-      neumann_boundary_condition.initialize(
-        vars, neumann_boundary_conditions_expression, constants);
+          // 集成模式下网格可能来自之前的hp计算
+          for (const auto &cell : dof_handler.active_cell_iterators())
+            if (cell->is_locally_owned())
+              cell->set_active_fe_index(0);
+        }
     }
 
-  dof_handler.distribute_dofs(*fe);
+  update_mapping_cache();
+
+  if (use_hp)
+    dof_handler.distribute_dofs(fe_collection);
+  else
+    dof_handler.distribute_dofs(*fe);
+  renumber_dofs();
 
   locally_owned_dofs = dof_handler.locally_owned_dofs();
   DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_dofs);
@@ -177,28 +675,43 @@ BaseProblem<dim>::setup_system()
         << std::endl;
 
 
-  constraints.clear();
-  constraints.reinit(locally_relevant_dofs);
-  DoFTools::make_hanging_node_constraints(dof_handler, constraints);
-
-  for (const auto &id : dirichlet_ids)
-    VectorTools::interpolate_boundary_values(
-      *mapping, dof_handler, id, dirichlet_boundary_condition, constraints);
-  constraints.close();
-
-
-  DynamicSparsityPattern dsp(dof_handler.n_dofs());
-  DoFTools::make_sparsity_pattern(dof_handler, dsp, constraints, false);
-  SparsityTools::distribute_sparsity_pattern(dsp,
-                                             locally_owned_dofs,
-                                             mpi_communicator,
-                                             locally_relevant_dofs);
+  make_constraints(locally_relevant_dofs);
 
 
-  system_matrix.reinit(locally_owned_dofs,
-                       locally_owned_dofs,
-                       dsp,
-                       mpi_communicator);
+  // 显式格式等无矩阵的计算不需要稀疏模式和系统矩阵
+  if (allocate_system_matrix)
+    {
+      DynamicSparsityPattern dsp(dof_handler.n_dofs());
+      if (is_dg())
+        DoFTools::make_flux_sparsity_pattern(dof_handler,
+                                             dsp,
+                                             constraints,
+                                             false);
+      else
+        DoFTools::make_sparsity_pattern(dof_handler, dsp, constraints, false);
+      SparsityTools::distribute_sparsity_pattern(dsp,
+                                                 locally_owned_dofs,
+                                                 mpi_communicator,
+                                                 locally_relevant_dofs);
+
+      if (linear_algebra_backend == "native")
+        {
+          AssertThrow(Utilities::MPI::n_mpi_processes(mpi_communicator) == 1,
+                      ExcMessage(
+                        "The native backend runs on a single process."));
+          AssertThrow(n_load_cases() == 0,
+                      ExcMessage("Load cases require the Trilinos backend."));
+          native_sparsity.copy_from(dsp);
+          native_matrix.reinit(native_sparsity);
+          native_rhs.reinit(dof_handler.n_dofs());
+          native_solution.reinit(dof_handler.n_dofs());
+        }
+      else
+        system_matrix.reinit(locally_owned_dofs,
+                             locally_owned_dofs,
+                             dsp,
+                             mpi_communicator);
+    }
 
   solution.reinit(locally_owned_dofs, mpi_communicator);
   system_rhs.reinit(locally_owned_dofs, mpi_communicator);
@@ -209,6 +722,10 @@ BaseProblem<dim>::setup_system()
 
   error_per_cell.reinit(triangulation.n_active_cells());
 
+  direct_solver.reset();
+  amg.reset();
+  block_jacobi.reset();
+
   // Now call anything that may be needed hook
   // 可以在此基础上添加扩展，而尽量不改变原基类
   setup_system_call_back();
@@ -216,6 +733,195 @@ BaseProblem<dim>::setup_system()
 
 
 
+template <int dim>
+void
+BaseProblem<dim>::initialize_functions()
+{
+  const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
+  forcing_term.initialize(vars,
+                          forcing_term_expression,
+                          constants,
+                          time_dependent_functions);
+  exact_solution.initialize(vars,
+                            exact_solution_expression,
+                            constants,
+                            time_dependent_functions);
+
+  dirichlet_boundary_condition.initialize(
+    vars,
+    dirichlet_boundary_conditions_expression,
+    constants,
+    time_dependent_functions);
+
+  neumann_boundary_condition.initialize(
+    vars,
+    neumann_boundary_conditions_expression,
+    constants,
+    time_dependent_functions);
+}
+
+
+
+template <int dim>
+Threads::ThreadLocalStorage<
+  std::vector<typename BaseProblem<dim>::ScratchData>> &
+BaseProblem<dim>::get_assembly_scratch()
+{
+  if (!assembly_scratch)
+    {
+      // 每个有限元一个ScratchData，按cell->active_fe_index()选择。
+      // 每个线程第一次使用时从这个样本拷贝一份，之后一直重复使用。
+      std::vector<ScratchData> sample;
+      for (unsigned int i = 0; i < fe_collection.size(); ++i)
+        sample.emplace_back(*mapping,
+                            fe_collection[i],
+                            QGauss<dim>(fe_collection[i].degree + 1),
+                            update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values,
+                            QGauss<dim - 1>(fe_collection[i].degree + 1),
+                            update_values | update_quadrature_points |
+                              update_JxW_values);
+      assembly_scratch = std::make_unique<
+        Threads::ThreadLocalStorage<std::vector<ScratchData>>>(sample);
+    }
+  return *assembly_scratch;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::make_constraints(const IndexSet &relevant_dofs)
+{
+  TimerOutput::Scope timer_section(timer, "make_constraints");
+  constraints.clear();
+  constraints.reinit(relevant_dofs);
+
+  // 全局加密的网格上没有悬挂节点，不必遍历所有的单元。hp模式下相邻单元的
+  // 次数不同时，即使网格是协调的也需要约束。
+  if ((use_hp || triangulation.has_hanging_nodes()) && !is_dg())
+    DoFTools::make_hanging_node_constraints(dof_handler, constraints);
+
+  // DG的边界条件由面项弱施加
+  if (is_dg())
+    {
+      constraints.close();
+      return;
+    }
+
+  const Function<dim> *boundary_condition = &dirichlet_boundary_condition;
+  if (cache_boundary_values)
+    {
+      if (!cached_dirichlet_boundary_condition)
+        cached_dirichlet_boundary_condition =
+          std::make_unique<CachedFunction<dim>>(dirichlet_boundary_condition);
+      cached_dirichlet_boundary_condition->next_cycle();
+      boundary_condition = cached_dirichlet_boundary_condition.get();
+    }
+
+  // 所有的Dirichlet边界在一次遍历中处理
+  std::map<types::boundary_id, const Function<dim> *> boundary_functions;
+  for (const auto &id : dirichlet_ids)
+    boundary_functions[id] = boundary_condition;
+  VectorTools::interpolate_boundary_values(*mapping,
+                                           dof_handler,
+                                           boundary_functions,
+                                           constraints);
+  constraints.close();
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::renumber_dofs()
+{
+  if (dof_renumbering == "cuthill_mckee")
+    DoFRenumbering::Cuthill_McKee(dof_handler);
+  else if (dof_renumbering == "hierarchical")
+    DoFRenumbering::hierarchical(dof_handler);
+  else if (dof_renumbering == "downstream")
+    DoFRenumbering::downstream(dof_handler, downstream_direction);
+  else if (dof_renumbering == "matrix_free_data_locality")
+    {
+      AssertThrow(!use_hp, ExcNotImplemented());
+
+      // 按照MatrixFree遍历单元批次的顺序编号，使得同一批次中的单元所用的
+      // 自由度在内存中相邻
+      IndexSet relevant_dofs;
+      DoFTools::extract_locally_relevant_dofs(dof_handler, relevant_dofs);
+      AffineConstraints<double> hanging_node_constraints(relevant_dofs);
+      DoFTools::make_hanging_node_constraints(dof_handler,
+                                              hanging_node_constraints);
+      hanging_node_constraints.close();
+
+      typename MatrixFree<dim, double>::AdditionalData data;
+      data.tasks_parallel_scheme =
+        MatrixFree<dim, double>::AdditionalData::none;
+      DoFRenumbering::
+        matrix_free_data_locality<dim, dim, double, VectorizedArray<double>>(
+          dof_handler, hanging_node_constraints, data);
+    }
+  else
+    {
+      Assert(dof_renumbering == "none", ExcInternalError());
+    }
+}
+
+
+
+template <int dim>
+types::global_dof_index
+BaseProblem<dim>::matrix_bandwidth() const
+{
+  if (linear_algebra_backend == "native")
+    return native_sparsity.bandwidth();
+
+  // 遍历本地拥有的行中实际存储的元素
+  types::global_dof_index bandwidth = 0;
+  for (const auto row : locally_owned_dofs)
+    for (auto entry = system_matrix.begin(row); entry != system_matrix.end(row);
+         ++entry)
+      bandwidth = std::max<types::global_dof_index>(
+        bandwidth,
+        entry->column() > row ? entry->column() - row : row - entry->column());
+  return Utilities::MPI::max(bandwidth, mpi_communicator);
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::print_matrix_statistics()
+{
+  const unsigned int n_repetitions = 10;
+  const bool         native = (linear_algebra_backend == "native");
+
+  LA::MPI::Vector src(system_rhs);
+  LA::MPI::Vector dst(system_rhs);
+  src = 1.0;
+  Vector<double> native_src(native_rhs.size());
+  Vector<double> native_dst(native_rhs.size());
+  native_src = 1.0;
+
+  Timer spmv_timer(mpi_communicator, true);
+  for (unsigned int i = 0; i < n_repetitions; ++i)
+    if (native)
+      native_matrix.vmult(native_dst, native_src);
+    else
+      system_matrix.vmult(dst, src);
+  spmv_timer.stop();
+
+  pcout << "DoF renumbering: " << dof_renumbering
+        << ", matrix bandwidth: " << matrix_bandwidth() << ", nonzeros: "
+        << (native ? native_matrix.n_nonzero_elements() :
+                     system_matrix.n_nonzero_elements())
+        << ", SpMV time: " << spmv_timer.wall_time() / n_repetitions << "s"
+        << std::endl;
+}
+
+
+
 template <int dim>
 void
 BaseProblem<dim>::assemble_system_one_cell(
@@ -232,11 +938,29 @@ template <int dim>
 void
 BaseProblem<dim>::copy_one_cell(const CopyData &copy)
 {
-  constraints.distribute_local_to_global(copy.matrices[0],
-                                         copy.vectors[0],
-                                         copy.local_dof_indices[0],
-                                         system_matrix,
-                                         system_rhs);
+  if (linear_algebra_backend == "native")
+    {
+      if (assemble_rhs_only)
+        constraints.distribute_local_to_global(copy.vectors[0],
+                                               copy.local_dof_indices[0],
+                                               native_rhs);
+      else
+        constraints.distribute_local_to_global(copy.matrices[0],
+                                               copy.vectors[0],
+                                               copy.local_dof_indices[0],
+                                               native_matrix,
+                                               native_rhs);
+    }
+  else if (assemble_rhs_only)
+    constraints.distribute_local_to_global(copy.vectors[0],
+                                           copy.local_dof_indices[0],
+                                           system_rhs);
+  else
+    constraints.distribute_local_to_global(copy.matrices[0],
+                                           copy.vectors[0],
+                                           copy.local_dof_indices[0],
+                                           system_matrix,
+                                           system_rhs);
 }
 
 
@@ -245,20 +969,13 @@ template <int dim>
 void
 BaseProblem<dim>::assemble_system()
 {
-  TimerOutput::Scope timer_section(timer, "assemble_system");
-  QGauss<dim>        quadrature_formula(fe->degree + 1);
-  QGauss<dim - 1>    face_quadrature_formula(fe->degree + 1);
+  TimerOutput::Scope timer_section(timer,
+                                   assemble_rhs_only ? "assemble_rhs" :
+                                                       "assemble_system");
 
-  ScratchData scratch(*mapping,
-                      *fe,
-                      quadrature_formula,
-                      update_values | update_gradients |
-                        update_quadrature_points | update_JxW_values,
-                      face_quadrature_formula,
-                      update_values | update_quadrature_points |
-                        update_JxW_values);
+  auto &scratch_pool = get_assembly_scratch();
 
-  CopyData copy(fe->n_dofs_per_cell());
+  CopyData copy(fe_collection.max_dofs_per_cell());
 
   // for (const auto &cell : dof_handler.active_cell_iterators())
   //   if (cell->is_locally_owned())
@@ -269,8 +986,25 @@ BaseProblem<dim>::assemble_system()
   /**
    * 将 MPI 和 Threads 合并
    */
-  auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
-    assemble_system_one_cell(cell, scratch, copy);
+  // WorkStream自己的scratch参数不用：ScratchData取自线程局部的池
+  auto worker = [&](const auto &cell, unsigned int &, auto &copy) {
+#ifdef DEBUG
+    const auto n_allocations = n_thread_local_allocations();
+#endif
+    // hp模式下每个单元的自由度数可能不同
+    const unsigned int n_dofs = cell->get_fe().n_dofs_per_cell();
+    if (copy.local_dof_indices[0].size() != n_dofs)
+      {
+        copy.matrices[0].reinit(n_dofs, n_dofs);
+        copy.vectors[0].reinit(n_dofs);
+        copy.local_dof_indices[0].resize(n_dofs);
+      }
+    assemble_system_one_cell(cell,
+                             scratch_pool.get()[cell->active_fe_index()],
+                             copy);
+#ifdef DEBUG
+    n_assembly_allocations += n_thread_local_allocations() - n_allocations;
+#endif
   };
 
   auto copier = [&](const auto &copy) { copy_one_cell(copy); };
@@ -278,132 +1012,1227 @@ BaseProblem<dim>::assemble_system()
   using CellFilter =
     FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>;
 
-  WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
-                             dof_handler.begin_active()), // is_locally_owned
-                  CellFilter(IteratorFilters::LocallyOwnedCell(),
-                             dof_handler.end()),
-                  worker,
-                  copier,
-                  scratch,
-                  copy);
+  if (is_dg())
+    assemble_system_dg();
+  else if (!batched_assembly)
+    WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dof_handler.begin_active()), // is_locally_owned
+                    CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dof_handler.end()),
+                    worker,
+                    copier,
+                    0u,
+                    copy);
+  else
+    {
+      // 把使用同一个有限元的本地单元按VectorizedArray的宽度分组
+      const unsigned int n_lanes = VectorizedArray<double>::size();
+      std::vector<std::vector<typename DoFHandler<dim>::active_cell_iterator>>
+                                batches;
+      std::vector<unsigned int> open_batch(fe_collection.size(),
+                                           numbers::invalid_unsigned_int);
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        if (cell->is_locally_owned())
+          {
+            auto &batch = open_batch[cell->active_fe_index()];
+            if (batch == numbers::invalid_unsigned_int ||
+                batches[batch].size() == n_lanes)
+              {
+                batch = batches.size();
+                batches.emplace_back();
+                batches.back().reserve(n_lanes);
+              }
+            batches[batch].push_back(cell);
+          }
+
+      struct BatchCopyData
+      {
+        unsigned int          n_cells = 0;
+        std::vector<CopyData> copies;
+      };
+      BatchCopyData sample_batch_copy;
+      sample_batch_copy.copies.resize(n_lanes, copy);
+
+      auto batch_worker =
+        [&](const auto &batch, unsigned int &, BatchCopyData &batch_copy) {
+#ifdef DEBUG
+          const auto n_allocations = n_thread_local_allocations();
+#endif
+          batch_copy.n_cells = batch->size();
+          const unsigned int n_dofs =
+            batch->front()->get_fe().n_dofs_per_cell();
+          for (auto &copy : batch_copy.copies)
+            if (copy.local_dof_indices[0].size() != n_dofs)
+              {
+                copy.matrices[0].reinit(n_dofs, n_dofs);
+                copy.vectors[0].reinit(n_dofs);
+                copy.local_dof_indices[0].resize(n_dofs);
+              }
+          assemble_system_batch(
+            *batch,
+            scratch_pool.get()[batch->front()->active_fe_index()],
+            batch_copy.copies);
+#ifdef DEBUG
+          n_assembly_allocations +=
+            n_thread_local_allocations() - n_allocations;
+#endif
+        };
+
+      auto batch_copier = [&](const BatchCopyData &batch_copy) {
+        for (unsigned int i = 0; i < batch_copy.n_cells; ++i)
+          copy_one_cell(batch_copy.copies[i]);
+      };
+
+      WorkStream::run(batches.cbegin(),
+                      batches.cend(),
+                      batch_worker,
+                      batch_copier,
+                      0u,
+                      sample_batch_copy);
+    }
 
 
-  system_matrix.compress(VectorOperation::add);
+  if (linear_algebra_backend == "native")
+    return;
+
   system_rhs.compress(VectorOperation::add);
+  if (!assemble_rhs_only)
+    {
+      system_matrix.compress(VectorOperation::add);
+
+      // 矩阵已经改变，旧的分解和预条件子不再有效
+      direct_solver.reset();
+      amg.reset();
+      block_jacobi.reset();
+    }
 }
 
 
 
 template <int dim>
 void
-BaseProblem<dim>::solve()
+BaseProblem<dim>::assemble_system_batch(
+  const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+  ScratchData &                                                      scratch,
+  std::vector<CopyData> &                                            copies)
 {
-  TimerOutput::Scope        timer_section(timer, "solve");
-  SolverCG<LA::MPI::Vector> solver(solver_control);
-  LA::MPI::PreconditionAMG  amg;
-  amg.initialize(system_matrix);
-  solver.solve(system_matrix, solution, system_rhs, amg);
-  constraints.distribute(solution);
-  locally_relevant_solution = solution;
+  for (unsigned int i = 0; i < cells.size(); ++i)
+    assemble_system_one_cell(cells[i], scratch, copies[i]);
 }
 
 
 
 template <int dim>
-void
-BaseProblem<dim>::estimate()
+bool
+BaseProblem<dim>::is_dg() const
 {
-  TimerOutput::Scope timer_section(timer, "estimate");
-  if (estimator_type == "exact")
-    {
-      error_per_cell = 0;
-      QGauss<dim> quad(fe->degree + 1);
-      VectorTools::integrate_difference(*mapping,
-                                        dof_handler,
-                                        locally_relevant_solution,
-                                        exact_solution,
-                                        error_per_cell,
-                                        quad,
-                                        VectorTools::H1_seminorm);
-    }
-  else if (estimator_type == "kelly")
-    {
-      std::map<types::boundary_id, const Function<dim> *> neumann;
-      for (const auto id : neumann_ids)
-        neumann[id] = &neumann_boundary_condition;
-
-      QGauss<dim - 1> face_quad(fe->degree + 1);
-      KellyErrorEstimator<dim>::estimate(*mapping,
-                                         dof_handler,
-                                         face_quad,
-                                         neumann,
-                                         locally_relevant_solution,
-                                         error_per_cell);
-    }
-  else if (estimator_type == "residual")
-    {
-      // h_T || f+\Delta u_h ||_0,T
-      // + \sum over faces
-      // 1/2 (h_F)^{1/2} || [n.\nabla u_h] ||_0,F
-
-      QGauss<dim - 1> face_quad(fe->degree + 1);
-      QGauss<dim>     quad(fe->degree + 1);
+  if (!fe)
+    return false;
+  // 只有所有的基本单元都不连续时才是DG，例如FE_Q^d x FE_DGP的Stokes单元
+  // 仍然是连续的，它的速度需要强施加的Dirichlet条件
+  for (unsigned int b = 0; b < fe->n_base_elements(); ++b)
+    if (fe->base_element(b).conforms(FiniteElementData<dim>::H1))
+      return false;
+  return true;
+}
 
-      std::map<types::boundary_id, const Function<dim> *> neumann;
-      for (const auto id : neumann_ids)
-        neumann[id] = &neumann_boundary_condition;
 
-      KellyErrorEstimator<dim>::estimate(*mapping,
-                                         dof_handler,
-                                         face_quad,
-                                         neumann,
-                                         locally_relevant_solution,
-                                         error_per_cell);
 
-      FEValues<dim> fe_values(*mapping,
-                              *fe,
-                              quad,
-                              update_hessians | update_JxW_values |
-                                update_quadrature_points);
+template <int dim>
+void
+BaseProblem<dim>::assemble_boundary_face_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  const unsigned int,
+  ScratchData &,
+  CopyData &)
+{
+  Assert(false, ExcPureFunctionCalled());
+}
 
-      std::vector<double> local_laplacians(quad.size());
 
 
-      double residual_L2_norm = 0;
+template <int dim>
+void
+BaseProblem<dim>::assemble_interior_face(
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  const unsigned int,
+  const unsigned int,
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  const unsigned int,
+  const unsigned int,
+  ScratchData &,
+  FaceCopyData &)
+{
+  Assert(false, ExcPureFunctionCalled());
+}
 
-      unsigned int cell_index = 0;
-      for (const auto &cell : dof_handler.active_cell_iterators())
+
+
+template <int dim>
+void
+BaseProblem<dim>::assemble_system_dg()
+{
+  AssertThrow(!use_hp, ExcNotImplemented());
+
+  // 面上需要梯度和法向量。内部面的FEInterfaceValues也用这些更新标志
+  ScratchData sample_scratch(*mapping,
+                             *fe,
+                             QGauss<dim>(fe->degree + 1),
+                             update_values | update_gradients |
+                               update_quadrature_points | update_JxW_values,
+                             QGauss<dim - 1>(fe->degree + 1),
+                             update_values | update_gradients |
+                               update_quadrature_points | update_JxW_values |
+                               update_normal_vectors);
+  DGCopyData  sample_copy(fe->n_dofs_per_cell());
+
+  using Iterator = typename DoFHandler<dim>::active_cell_iterator;
+
+  auto cell_worker =
+    [&](const Iterator &cell, ScratchData &scratch, DGCopyData &copy) {
+      copy.faces.clear();
+      assemble_system_one_cell(cell, scratch, copy.cell);
+    };
+
+  auto boundary_worker = [&](const Iterator &    cell,
+                             const unsigned int &face_no,
+                             ScratchData &       scratch,
+                             DGCopyData &        copy) {
+    if (dirichlet_ids.find(cell->face(face_no)->boundary_id()) !=
+        dirichlet_ids.end())
+      assemble_boundary_face_one_cell(cell, face_no, scratch, copy.cell);
+  };
+
+  auto face_worker = [&](const Iterator &    cell,
+                         const unsigned int &face_no,
+                         const unsigned int &subface_no,
+                         const Iterator &    neighbor,
+                         const unsigned int &neighbor_face_no,
+                         const unsigned int &neighbor_subface_no,
+                         ScratchData &       scratch,
+                         DGCopyData &        copy) {
+    // 内部面只对矩阵有贡献
+    if (assemble_rhs_only)
+      return;
+    copy.faces.emplace_back();
+    assemble_interior_face(cell,
+                           face_no,
+                           subface_no,
+                           neighbor,
+                           neighbor_face_no,
+                           neighbor_subface_no,
+                           scratch,
+                           copy.faces.back());
+  };
+
+  auto copier = [&](const DGCopyData &copy) {
+    copy_one_cell(copy.cell);
+    for (const auto &face : copy.faces)
+      {
+        if (linear_algebra_backend == "native")
+          constraints.distribute_local_to_global(face.matrix,
+                                                 face.joint_dof_indices,
+                                                 native_matrix);
+        else
+          constraints.distribute_local_to_global(face.matrix,
+                                                 face.joint_dof_indices,
+                                                 system_matrix);
+      }
+  };
+
+  // 与其他进程共享的面只在其中一个进程上装配
+  MeshWorker::mesh_loop(
+    filter_iterators(dof_handler.active_cell_iterators(),
+                     IteratorFilters::LocallyOwnedCell()),
+    cell_worker,
+    copier,
+    sample_scratch,
+    sample_copy,
+    MeshWorker::assemble_own_cells | MeshWorker::assemble_boundary_faces |
+      MeshWorker::assemble_own_interior_faces_once |
+      MeshWorker::assemble_ghost_faces_once,
+    boundary_worker,
+    face_worker);
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::assemble_rhs()
+{
+  if (linear_algebra_backend == "native")
+    native_rhs = 0;
+  else
+    system_rhs = 0;
+  assemble_rhs_only = true;
+  assemble_system();
+  assemble_rhs_only = false;
+}
+
+
+
+template <int dim>
+ParsedConvergenceTable &
+BaseProblem<dim>::current_error_table()
+{
+  if (current_load_case != numbers::invalid_unsigned_int)
+    return load_case_error_tables[current_load_case];
+  if (run_error_table)
+    return *run_error_table;
+  return error_table;
+}
+
+
+
+template <int dim>
+unsigned int
+BaseProblem<dim>::n_load_cases() const
+{
+  return std::max(load_case_forcing_term_expressions.size(),
+                  load_case_neumann_boundary_conditions_expressions.size());
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::set_load_case(const unsigned int load_case)
+{
+  AssertIndexRange(load_case, n_load_cases());
+  const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
+
+  // 没有给出的表达式使用默认值
+  forcing_term.initialize(
+    vars,
+    load_case < load_case_forcing_term_expressions.size() ?
+      load_case_forcing_term_expressions[load_case] :
+      forcing_term_expression,
+    constants);
+
+  neumann_boundary_condition.initialize(
+    vars,
+    load_case < load_case_neumann_boundary_conditions_expressions.size() ?
+      load_case_neumann_boundary_conditions_expressions[load_case] :
+      neumann_boundary_conditions_expression,
+    constants);
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::compute_lift()
+{
+  // 非齐次约束的提升项对所有右手边都相同，因此只需计算一次
+  lift = system_rhs;
+  assemble_rhs();
+  lift -= system_rhs;
+  system_rhs += lift;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::solve_load_cases(const unsigned int cycle)
+{
+  // system_rhs中包含第零个工况的完整右手边
+  compute_lift();
+
+  // ParsedConvergenceTable不能赋值，只能拷贝构造
+  if (load_case_error_tables.size() != n_load_cases())
+    {
+      load_case_error_tables.clear();
+      for (unsigned int i = 0; i < n_load_cases(); ++i)
+        load_case_error_tables.emplace_back(error_table);
+    }
+  load_case_errors.resize(n_load_cases());
+
+  Vector<float> accumulated_error(error_per_cell.size());
+  for (unsigned int load_case = 0; load_case < n_load_cases(); ++load_case)
+    {
+      current_load_case = load_case;
+      if (load_case > 0)
         {
-          fe_values.reinit(cell);
+          set_load_case(load_case);
+          assemble_rhs();
+          system_rhs += lift;
+        }
+
+      solve();
+      if (cycle == 0 && load_case == 0)
+        print_startup_statistics();
+      estimate();
+      output_results(cycle);
+      diagnostics(cycle);
+      load_case_errors[load_case] = latest_errors;
+
+      // 按所有工况的误差平方和进行标记
+      Vector<float> squared_error(error_per_cell);
+      squared_error.scale(error_per_cell);
+      accumulated_error += squared_error;
+    }
+
+  for (auto &e : accumulated_error)
+    e = std::sqrt(e);
+  error_per_cell = accumulated_error;
+
+  current_load_case = numbers::invalid_unsigned_int;
+}
+
 
-          fe_values.get_function_laplacians(locally_relevant_solution,
-                                            local_laplacians);
-          residual_L2_norm = 0;
-          for (const auto q_index : fe_values.quadrature_point_indices())
+
+template <int dim>
+TrilinosWrappers::PreconditionAMG::AdditionalData
+BaseProblem<dim>::amg_data(const DoFHandler<dim> &dofs) const
+{
+  TrilinosWrappers::PreconditionAMG::AdditionalData data;
+  data.elliptic              = amg_elliptic;
+  data.higher_order_elements = amg_higher_order_elements;
+  data.n_cycles              = amg_n_cycles;
+  data.w_cycle               = amg_w_cycle;
+  data.aggregation_threshold = amg_aggregation_threshold;
+  data.smoother_sweeps       = amg_smoother_sweeps;
+  data.smoother_overlap      = amg_smoother_overlap;
+  data.smoother_type         = amg_smoother_type.c_str();
+  data.coarse_type           = amg_coarse_type.c_str();
+
+  // 默认情况下ML只把一个全局常数当作近零空间，对向量值问题应按分量给出
+  if (amg_component_constant_modes && n_components > 1)
+    DoFTools::extract_constant_modes(dofs,
+                                     ComponentMask(n_components, true),
+                                     data.constant_modes);
+  return data;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::solve()
+{
+  TimerOutput::Scope timer_section(timer, "solve");
+  if (linear_algebra_backend == "native")
+    {
+      SolverCG<Vector<double>> solver(solver_control);
+      auto solve_with = [&](const auto &preconditioner) {
+        solver.solve(native_matrix,
+                     native_solution,
+                     native_rhs,
+                     preconditioner);
+      };
+
+      if (native_preconditioner == "ssor")
+        {
+          PreconditionSSOR<SparseMatrix<double>> preconditioner;
+          preconditioner.initialize(native_matrix, 1.2);
+          solve_with(preconditioner);
+        }
+      else if (native_preconditioner == "jacobi")
+        {
+          PreconditionJacobi<SparseMatrix<double>> preconditioner;
+          preconditioner.initialize(native_matrix);
+          solve_with(preconditioner);
+        }
+      else
+        {
+          // 对角线的逆由initialize()从矩阵中计算
+          using Chebyshev =
+            PreconditionChebyshev<SparseMatrix<double>, Vector<double>>;
+          typename Chebyshev::AdditionalData data;
+          data.degree          = 4;
+          data.smoothing_range = 20.;
+          Chebyshev preconditioner;
+          preconditioner.initialize(native_matrix, data);
+          solve_with(preconditioner);
+        }
+      solution = native_solution;
+    }
+  else if (use_direct_solver ||
+           dof_handler.n_dofs() <= direct_solver_dofs_threshold)
+    {
+      if (!direct_solver)
+        {
+          TimerOutput::Scope timer_section(timer, "factorize");
+          direct_solver = std::make_unique<TrilinosWrappers::SolverDirect>(
+            solver_control,
+            TrilinosWrappers::SolverDirect::AdditionalData(false,
+                                                           direct_solver_type));
+          direct_solver->initialize(system_matrix);
+        }
+      direct_solver->solve(solution, system_rhs);
+    }
+  else
+    {
+      const TrilinosWrappers::PreconditionBase *preconditioner = nullptr;
+      if (is_dg() && dg_preconditioner == "block_jacobi")
+        {
+          if (!block_jacobi)
             {
-              const auto arg =
-                (local_laplacians[q_index] +
-                 forcing_term.value(fe_values.quadrature_point(q_index)));
-              residual_L2_norm += arg * arg * fe_values.JxW(q_index);
+              TimerOutput::Scope timer_section(timer, "setup_block_jacobi");
+              block_jacobi =
+                std::make_unique<TrilinosWrappers::PreconditionBlockJacobi>();
+              block_jacobi->initialize(
+                system_matrix,
+                TrilinosWrappers::PreconditionBlockJacobi::AdditionalData(
+                  fe->n_dofs_per_cell()));
             }
-          error_per_cell[cell_index] +=
-            cell->diameter() * std::sqrt(residual_L2_norm);
-
-          ++cell_index;
+          preconditioner = block_jacobi.get();
         }
+      else
+        {
+          if (!amg)
+            {
+              TimerOutput::Scope timer_section(timer, "setup_amg");
+              amg = std::make_unique<LA::MPI::PreconditionAMG>();
+              amg->initialize(system_matrix, amg_data(dof_handler));
+            }
+          preconditioner = amg.get();
+        }
+      Timer solver_timer(mpi_communicator, true);
+      if (iterative_solver == "cg")
+        {
+          SolverCG<LA::MPI::Vector> solver(solver_control);
+          solver.solve(system_matrix, solution, system_rhs, *preconditioner);
+        }
+      else
+        {
+          SolverPipelinedCG<LA::MPI::Vector> solver(
+            solver_control,
+            typename SolverPipelinedCG<LA::MPI::Vector>::AdditionalData(
+              iterative_solver == "pipelined_cg",
+              residual_replacement_interval));
+          solver.solve(system_matrix, solution, system_rhs, *preconditioner);
+        }
+      solver_timer.stop();
+
+      // 用不同的进程数运行，比较各个求解器每一步的时间
+      if (report_solver_statistics)
+        pcout << "Solver " << iterative_solver << ": "
+              << solver_control.last_step() << " iterations, "
+              << solver_timer.wall_time() /
+                   std::max(solver_control.last_step(), 1u)
+              << " s/iteration on "
+              << Utilities::MPI::n_mpi_processes(mpi_communicator)
+              << " processes" << std::endl;
+    }
+  constraints.distribute(solution);
+  locally_relevant_solution = solution;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::estimate()
+{
+  TimerOutput::Scope timer_section(timer, "estimate");
+  if (estimator_type == "exact")
+    {
+      // 单元上的H1半范数误差在evaluate_errors()中和其他范数一起计算
+      error_per_cell = 0;
+    }
+  else if (estimator_type == "kelly" || estimator_type == "residual" ||
+           estimator_type == "dwr")
+    {
+      // h_T || f+\nabla\cdot(a\nabla u_h) ||_0,T
+      // + \sum over faces
+      // 1/2 (h_F)^{1/2} || [n.a\nabla u_h] ||_0,F
+      // 单元项在evaluate_errors()中计算，这里只计算面上的跳跃项。"kelly"
+      // 估计器只看梯度的跳跃，不乘以系数a。
+
+      std::map<types::boundary_id, const Function<dim> *> neumann;
+      for (const auto id : neumann_ids)
+        neumann[id] = &neumann_boundary_condition;
+
+      hp::QCollection<dim - 1> face_quad;
+      for (unsigned int i = 0; i < fe_collection.size(); ++i)
+        face_quad.push_back(QGauss<dim - 1>(fe_collection[i].degree + 1));
+
+      KellyErrorEstimator<dim>::estimate(*mapping,
+                                         dof_handler,
+                                         face_quad,
+                                         neumann,
+                                         locally_relevant_solution,
+                                         error_per_cell,
+                                         ComponentMask(),
+                                         estimator_type == "kelly" ?
+                                           nullptr :
+                                           estimator_coefficient());
     }
   else
     {
       AssertThrow(false, ExcNotImplemented());
     }
-  auto global_estimator = error_per_cell.l2_norm();
-  error_table.add_extra_column("estimator", [global_estimator]() {
-    return global_estimator;
-  });
-  error_table.error_from_exact(*mapping,
-                               dof_handler,
-                               locally_relevant_solution,
-                               exact_solution);
+
+  // 残差在evaluate_errors()中与面上的跳跃合在一起后再乘以对偶权重
+  if (estimator_type == "dwr")
+    compute_dual_weights();
+  evaluate_errors(locally_relevant_solution);
+}
+
+
+
+template <int dim>
+std::pair<double, double>
+BaseProblem<dim>::assemble_goal_functional(
+  const DoFHandler<dim> &          dofs,
+  const LA::MPI::Vector &          discrete_solution,
+  LA::MPI::Vector &                dual_rhs,
+  const AffineConstraints<double> &dual_constraints) const
+{
+  AssertIndexRange(goal_component, n_components);
+  dual_rhs = 0;
+
+  double                               value       = 0;
+  double                               exact_value = 0;
+  Vector<double>                       cell_rhs;
+  std::vector<types::global_dof_index> dof_indices;
+
+  // J(u_h) = \sum_i J(\varphi_i) u_i，与右端项一起计算
+  auto distribute = [&](const auto &cell) {
+    dof_indices.resize(cell->get_fe().n_dofs_per_cell());
+    cell->get_dof_indices(dof_indices);
+    for (unsigned int i = 0; i < dof_indices.size(); ++i)
+      value += cell_rhs(i) * discrete_solution(dof_indices[i]);
+    dual_constraints.distribute_local_to_global(cell_rhs,
+                                                dof_indices,
+                                                dual_rhs);
+  };
+
+  if (goal_functional == "point_value")
+    {
+      typename DoFHandler<dim>::active_cell_iterator found;
+      Point<dim>                                     unit_point;
+      bool                                           have_point = false;
+      for (const auto &cell : dofs.active_cell_iterators())
+        if (cell->is_locally_owned() && cell->point_inside(goal_point))
+          {
+            found      = cell;
+            unit_point = mapping->transform_real_to_unit_cell(cell, goal_point);
+            have_point = true;
+            break;
+          }
+
+      // 点在几个进程的单元之间时，只让编号最小的进程贡献
+      const unsigned int this_rank =
+        Utilities::MPI::this_mpi_process(mpi_communicator);
+      const unsigned int n_ranks =
+        Utilities::MPI::n_mpi_processes(mpi_communicator);
+      const unsigned int owner =
+        Utilities::MPI::min(have_point ? this_rank : n_ranks,
+                            mpi_communicator);
+      AssertThrow(owner < n_ranks,
+                  ExcMessage("The evaluation point of the goal functional "
+                             "is not inside the domain."));
+
+      if (owner == this_rank)
+        {
+          FEValues<dim> fe_values(*mapping,
+                                  found->get_fe(),
+                                  Quadrature<dim>(unit_point),
+                                  update_values);
+          fe_values.reinit(found);
+          cell_rhs.reinit(found->get_fe().n_dofs_per_cell());
+          for (const unsigned int i : fe_values.dof_indices())
+            cell_rhs(i) = fe_values.shape_value_component(i, 0, goal_component);
+          distribute(found);
+        }
+      exact_value = exact_solution.value(goal_point, goal_component);
+    }
+  else
+    {
+      const auto &             dofs_fe_collection = dofs.get_fe_collection();
+      hp::QCollection<dim>     quadrature;
+      hp::QCollection<dim - 1> face_quadrature;
+      for (unsigned int i = 0; i < dofs_fe_collection.size(); ++i)
+        {
+          quadrature.push_back(QGauss<dim>(dofs_fe_collection[i].degree + 1));
+          face_quadrature.push_back(
+            QGauss<dim - 1>(dofs_fe_collection[i].degree + 1));
+        }
+      const UpdateFlags flags =
+        update_values | update_quadrature_points | update_JxW_values;
+      hp::FEValues<dim>     hp_fe_values(*mapping,
+                                         dofs_fe_collection,
+                                         quadrature,
+                                         flags);
+      hp::FEFaceValues<dim> hp_fe_face_values(*mapping,
+                                              dofs_fe_collection,
+                                              face_quadrature,
+                                              flags);
+
+      auto integrate = [&](const auto &fe_values) {
+        for (const auto q : fe_values.quadrature_point_indices())
+          {
+            const double JxW = fe_values.JxW(q);
+            exact_value +=
+              exact_solution.value(fe_values.quadrature_point(q),
+                                   goal_component) *
+              JxW;
+            for (const unsigned int i : fe_values.dof_indices())
+              cell_rhs(i) +=
+                fe_values.shape_value_component(i, q, goal_component) * JxW;
+          }
+      };
+
+      for (const auto &cell : dofs.active_cell_iterators())
+        if (cell->is_locally_owned())
+          {
+            cell_rhs.reinit(cell->get_fe().n_dofs_per_cell());
+            if (goal_functional == "domain_integral")
+              {
+                hp_fe_values.reinit(cell);
+                integrate(hp_fe_values.get_present_fe_values());
+              }
+            else if (cell->at_boundary())
+              {
+                for (const auto f : cell->face_indices())
+                  if (cell->face(f)->at_boundary() &&
+                      goal_boundary_ids.count(cell->face(f)->boundary_id()))
+                    {
+                      hp_fe_face_values.reinit(cell, f);
+                      integrate(hp_fe_face_values.get_present_fe_values());
+                    }
+              }
+            distribute(cell);
+          }
+    }
+  dual_rhs.compress(VectorOperation::add);
+
+  if (goal_functional != "point_value")
+    exact_value = Utilities::MPI::sum(exact_value, mpi_communicator);
+  return {Utilities::MPI::sum(value, mpi_communicator), exact_value};
+}
+
+
+
+namespace
+{
+  /**
+   * 把`fe`中的每个FE_Q换成高一阶的FE_Q，FESystem的结构保持不变。
+   */
+  template <int dim>
+  std::unique_ptr<FiniteElement<dim>>
+  enriched_element(const FiniteElement<dim> &fe)
+  {
+    if (dynamic_cast<const FE_Q<dim> *>(&fe) != nullptr)
+      return std::make_unique<FE_Q<dim>>(fe.degree + 1);
+
+    AssertThrow(dynamic_cast<const FESystem<dim> *>(&fe) != nullptr,
+                ExcMessage("The dwr estimator needs FE_Q elements or "
+                           "systems of FE_Q elements, not " +
+                           fe.get_name() + "."));
+    std::vector<std::unique_ptr<FiniteElement<dim>>> base_elements;
+    std::vector<const FiniteElement<dim> *>          pointers;
+    std::vector<unsigned int>                        multiplicities;
+    for (unsigned int b = 0; b < fe.n_base_elements(); ++b)
+      {
+        base_elements.push_back(enriched_element(fe.base_element(b)));
+        pointers.push_back(base_elements.back().get());
+        multiplicities.push_back(fe.element_multiplicity(b));
+      }
+    return std::make_unique<FESystem<dim>>(pointers, multiplicities);
+  }
+} // namespace
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::compute_dual_weights()
+{
+  TimerOutput::Scope timer_section(timer, "dual");
+  AssertThrow(linear_algebra_backend != "native" && !is_dg(),
+              ExcMessage("The dwr estimator requires the Trilinos backend "
+                         "and a continuous finite element."));
+
+  // 同阶空间中的对偶解满足 z_h - I_h z_h = 0，不能作为权重。在同一个网格上
+  // 用高一阶的有限元求解，每个单元的次数与原始问题对应。
+  hp::FECollection<dim> dual_fe_collection;
+  for (unsigned int i = 0; i < fe_collection.size(); ++i)
+    dual_fe_collection.push_back(*enriched_element(fe_collection[i]));
+
+  for (const auto &cell : dual_dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      cell->set_active_fe_index(
+        cell->as_dof_handler_iterator(dof_handler)->active_fe_index());
+  dual_dof_handler.distribute_dofs(dual_fe_collection);
+
+  const IndexSet dual_owned_dofs = dual_dof_handler.locally_owned_dofs();
+  IndexSet       dual_relevant_dofs;
+  DoFTools::extract_locally_relevant_dofs(dual_dof_handler,
+                                          dual_relevant_dofs);
+
+  // 对偶问题在Dirichlet边界上是齐次的
+  AffineConstraints<double> dual_constraints(dual_relevant_dofs);
+  DoFTools::make_hanging_node_constraints(dual_dof_handler, dual_constraints);
+  for (const auto id : dirichlet_ids)
+    DoFTools::make_zero_boundary_constraints(dual_dof_handler,
+                                             id,
+                                             dual_constraints);
+  dual_constraints.close();
+
+  DynamicSparsityPattern dsp(dual_dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dual_dof_handler,
+                                  dsp,
+                                  dual_constraints,
+                                  false);
+  SparsityTools::distribute_sparsity_pattern(dsp,
+                                             dual_owned_dofs,
+                                             mpi_communicator,
+                                             dual_relevant_dofs);
+  LA::MPI::SparseMatrix dual_matrix;
+  dual_matrix.reinit(dual_owned_dofs,
+                     dual_owned_dofs,
+                     dsp,
+                     mpi_communicator);
+
+  // 对偶矩阵由同一个assemble_system_one_cell()组装，右端项不用
+  {
+    TimerOutput::Scope timer_section(timer, "assemble_dual");
+
+    std::vector<ScratchData> sample_scratch;
+    for (unsigned int i = 0; i < dual_fe_collection.size(); ++i)
+      sample_scratch.emplace_back(
+        *mapping,
+        dual_fe_collection[i],
+        QGauss<dim>(dual_fe_collection[i].degree + 1),
+        update_values | update_gradients | update_quadrature_points |
+          update_JxW_values,
+        QGauss<dim - 1>(dual_fe_collection[i].degree + 1),
+        update_values | update_quadrature_points | update_JxW_values);
+
+    auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+      const unsigned int n_dofs = cell->get_fe().n_dofs_per_cell();
+      if (copy.local_dof_indices[0].size() != n_dofs)
+        {
+          copy.matrices[0].reinit(n_dofs, n_dofs);
+          copy.vectors[0].reinit(n_dofs);
+          copy.local_dof_indices[0].resize(n_dofs);
+        }
+      assemble_system_one_cell(cell, scratch[cell->active_fe_index()], copy);
+    };
+
+    auto copier = [&](const auto &copy) {
+      dual_constraints.distribute_local_to_global(copy.matrices[0],
+                                                  copy.local_dof_indices[0],
+                                                  dual_matrix);
+    };
+
+    using CellFilter =
+      FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>;
+
+    const bool rhs_only = assemble_rhs_only;
+    assemble_rhs_only   = false;
+    WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dual_dof_handler.begin_active()),
+                    CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dual_dof_handler.end()),
+                    worker,
+                    copier,
+                    sample_scratch,
+                    CopyData(dual_fe_collection.max_dofs_per_cell()));
+    assemble_rhs_only = rhs_only;
+    dual_matrix.compress(VectorOperation::add);
+  }
+
+  // u_h在高阶空间中的插值是精确的，J(u_h)可以在对偶空间中计算
+  LA::MPI::Vector dual_solution(dual_owned_dofs, mpi_communicator);
+  FETools::interpolate(dof_handler,
+                       locally_relevant_solution,
+                       dual_dof_handler,
+                       dual_solution);
+  locally_relevant_dual_solution.reinit(dual_owned_dofs,
+                                        dual_relevant_dofs,
+                                        mpi_communicator);
+  locally_relevant_dual_solution = dual_solution;
+
+  LA::MPI::Vector dual_rhs(dual_owned_dofs, mpi_communicator);
+  const auto      functional =
+    assemble_goal_functional(dual_dof_handler,
+                             locally_relevant_dual_solution,
+                             dual_rhs,
+                             dual_constraints);
+
+  // 这里的双线性形式都是对称的，A^T = A
+  dual_solution = 0;
+  if (use_direct_solver ||
+      dual_dof_handler.n_dofs() <= direct_solver_dofs_threshold)
+    {
+      TrilinosWrappers::SolverDirect solver(
+        solver_control,
+        TrilinosWrappers::SolverDirect::AdditionalData(false,
+                                                       direct_solver_type));
+      solver.solve(dual_matrix, dual_solution, dual_rhs);
+    }
+  else
+    {
+      LA::MPI::PreconditionAMG dual_amg;
+      dual_amg.initialize(dual_matrix, amg_data(dual_dof_handler));
+      SolverCG<LA::MPI::Vector> solver(solver_control);
+      solver.solve(dual_matrix, dual_solution, dual_rhs, dual_amg);
+    }
+  dual_constraints.distribute(dual_solution);
+  locally_relevant_dual_solution = dual_solution;
+
+  // 每个单元上 z - I_h z 的系数由局部的插值差矩阵给出
+  std::vector<FullMatrix<double>> interpolation_difference(
+    fe_collection.size());
+  hp::QCollection<dim> quadrature;
+  for (unsigned int i = 0; i < fe_collection.size(); ++i)
+    {
+      interpolation_difference[i].reinit(
+        dual_fe_collection[i].n_dofs_per_cell(),
+        dual_fe_collection[i].n_dofs_per_cell());
+      FETools::get_interpolation_difference_matrix(
+        dual_fe_collection[i], fe_collection[i], interpolation_difference[i]);
+      quadrature.push_back(QGauss<dim>(dual_fe_collection[i].degree + 1));
+    }
+  hp::FEValues<dim> hp_fe_values(*mapping,
+                                 dual_fe_collection,
+                                 quadrature,
+                                 update_values | update_JxW_values);
+
+  dual_weights.reinit(triangulation.n_active_cells());
+  Vector<double> local_dual_values;
+  Vector<double> local_difference;
+  for (const auto &cell : dual_dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      {
+        const unsigned int n_dofs = cell->get_fe().n_dofs_per_cell();
+        local_dual_values.reinit(n_dofs);
+        local_difference.reinit(n_dofs);
+        cell->get_dof_values(locally_relevant_dual_solution,
+                             local_dual_values);
+        interpolation_difference[cell->active_fe_index()].vmult(
+          local_difference, local_dual_values);
+
+        hp_fe_values.reinit(cell);
+        const auto &fe_values = hp_fe_values.get_present_fe_values();
+        double      norm_squared = 0;
+        for (const auto q : fe_values.quadrature_point_indices())
+          for (unsigned int c = 0; c < n_components; ++c)
+            {
+              double difference = 0;
+              for (const unsigned int i : fe_values.dof_indices())
+                difference += local_difference(i) *
+                              fe_values.shape_value_component(i, q, c);
+              norm_squared += difference * difference * fe_values.JxW(q);
+            }
+        dual_weights[cell->active_cell_index()] = std::sqrt(norm_squared);
+      }
+
+  const double value = functional.first;
+  const double error = std::abs(functional.second - functional.first);
+  auto &       table = current_error_table();
+  table.add_extra_column(
+    "functional", [value]() { return value; }, false);
+  table.add_extra_column("functional_error", [error]() { return error; });
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::compute_strong_residual(
+  const FEValues<dim> &        fe_values,
+  const Vector<double> &       local_dof_values,
+  std::vector<Vector<double>> &residuals) const
+{
+  forcing_term.vector_value_list(fe_values.get_quadrature_points(), residuals);
+  for (const auto q : fe_values.quadrature_point_indices())
+    for (const unsigned int i : fe_values.dof_indices())
+      {
+        const auto c = fe_values.get_fe().system_to_component_index(i).first;
+        residuals[q][c] +=
+          local_dof_values(i) * trace(fe_values.shape_hessian(i, q));
+      }
+}
+
+
+
+template <int dim>
+const Function<dim> *
+BaseProblem<dim>::estimator_coefficient() const
+{
+  return nullptr;
+}
+
+
+
+namespace
+{
+  /**
+   * evaluate_errors()中每个线程使用的临时数据。hp模式下每个有限元对应一个
+   * ScratchData，缓冲区的大小在每个单元上按积分点的个数调整。
+   */
+  template <int dim>
+  struct ErrorScratchData
+  {
+    ErrorScratchData(const Mapping<dim> &          mapping,
+                     const hp::FECollection<dim> & fe_collection,
+                     const hp::QCollection<dim> &  quadrature,
+                     const UpdateFlags             update_flags,
+                     const unsigned int            n_components)
+      : n_components(n_components)
+    {
+      for (unsigned int i = 0; i < fe_collection.size(); ++i)
+        scratch.emplace_back(mapping,
+                             fe_collection[i],
+                             quadrature[i],
+                             update_flags);
+    }
+
+    void
+    resize(const unsigned int n_q_points)
+    {
+      if (values.size() == n_q_points)
+        return;
+      values.resize(n_q_points, Vector<double>(n_components));
+      exact_values.resize(n_q_points, Vector<double>(n_components));
+      residuals.resize(n_q_points, Vector<double>(n_components));
+      gradients.resize(n_q_points, std::vector<Tensor<1, dim>>(n_components));
+      exact_gradients.resize(n_q_points,
+                             std::vector<Tensor<1, dim>>(n_components));
+    }
+
+    unsigned int n_components;
+
+    std::vector<MeshWorker::ScratchData<dim>> scratch;
+
+    std::vector<Vector<double>> values;
+    std::vector<Vector<double>> exact_values;
+    std::vector<Vector<double>> residuals;
+    Vector<double>              local_dof_values;
+
+    std::vector<std::vector<Tensor<1, dim>>> gradients;
+    std::vector<std::vector<Tensor<1, dim>>> exact_gradients;
+  };
+
+
+
+  /**
+   * 一个单元对各个误差范数和估计器的贡献。
+   */
+  struct ErrorCopyData
+  {
+    ErrorCopyData(const unsigned int n_groups)
+      : l2_squared(n_groups)
+      , h1_seminorm_squared(n_groups)
+      , linfty(n_groups)
+    {}
+
+    unsigned int        cell_index = 0;
+    std::vector<double> l2_squared;
+    std::vector<double> h1_seminorm_squared;
+    std::vector<double> linfty;
+    double              estimator = 0;
+  };
+} // namespace
+
+
+
+template <int dim>
+template <typename VectorType>
+void
+BaseProblem<dim>::evaluate_errors(const VectorType &solution,
+                                  const bool        compute_estimator)
+{
+  TimerOutput::Scope timer_section(timer, "evaluate_errors");
+
+  // 同名的分量组成一组，与ParsedConvergenceTable的约定相同
+  std::vector<std::string>  group_names;
+  std::vector<unsigned int> component_to_group(n_components);
+  for (unsigned int c = 0; c < n_components; ++c)
+    {
+      const auto it = std::find(group_names.begin(),
+                                group_names.end(),
+                                error_component_names[c]);
+      component_to_group[c] = it - group_names.begin();
+      if (it == group_names.end())
+        group_names.push_back(error_component_names[c]);
+    }
+  const unsigned int n_groups = group_names.size();
+
+  const bool exact_estimator = compute_estimator && estimator_type == "exact";
+  const bool dwr_estimator = compute_estimator && estimator_type == "dwr";
+  const bool residual_estimator =
+    compute_estimator && (estimator_type == "residual" || dwr_estimator);
+  const bool need_gradients = exact_estimator ||
+                              error_norms.count(VectorTools::H1_norm) ||
+                              error_norms.count(VectorTools::H1_seminorm);
+
+  UpdateFlags flags = update_values | update_quadrature_points |
+                      update_JxW_values;
+  if (need_gradients)
+    flags |= update_gradients;
+  if (residual_estimator)
+    flags |= update_gradients | update_hessians;
+
+  hp::QCollection<dim> quadrature;
+  for (unsigned int i = 0; i < fe_collection.size(); ++i)
+    quadrature.push_back(QGauss<dim>(fe_collection[i].degree + 2));
+
+  ErrorScratchData<dim> sample_scratch(
+    *mapping, fe_collection, quadrature, flags, n_components);
+  ErrorCopyData sample_copy(n_groups);
+
+  auto worker = [&](const typename DoFHandler<dim>::active_cell_iterator &cell,
+                    ErrorScratchData<dim> &scratch,
+                    ErrorCopyData &        copy) {
+    const auto &fe_values =
+      scratch.scratch[cell->active_fe_index()].reinit(cell);
+    const auto &points = fe_values.get_quadrature_points();
+    scratch.resize(points.size());
+
+    copy.cell_index = cell->active_cell_index();
+    std::fill(copy.l2_squared.begin(), copy.l2_squared.end(), 0.0);
+    std::fill(copy.h1_seminorm_squared.begin(),
+              copy.h1_seminorm_squared.end(),
+              0.0);
+    std::fill(copy.linfty.begin(), copy.linfty.end(), 0.0);
+    copy.estimator = 0;
+
+    fe_values.get_function_values(solution, scratch.values);
+    exact_solution.vector_value_list(points, scratch.exact_values);
+    if (need_gradients)
+      {
+        fe_values.get_function_gradients(solution, scratch.gradients);
+        exact_solution.vector_gradient_list(points, scratch.exact_gradients);
+      }
+    if (residual_estimator)
+      {
+        scratch.local_dof_values.reinit(cell->get_fe().n_dofs_per_cell());
+        cell->get_dof_values(solution, scratch.local_dof_values);
+        compute_strong_residual(fe_values,
+                                scratch.local_dof_values,
+                                scratch.residuals);
+      }
+
+    double h1_seminorm_squared = 0;
+    double residual_squared    = 0;
+    for (const auto q : fe_values.quadrature_point_indices())
+      {
+        const double JxW = fe_values.JxW(q);
+        for (unsigned int c = 0; c < n_components; ++c)
+          {
+            const auto   g = component_to_group[c];
+            const double difference =
+              scratch.exact_values[q][c] - scratch.values[q][c];
+            copy.l2_squared[g] += difference * difference * JxW;
+            copy.linfty[g] = std::max(copy.linfty[g], std::abs(difference));
+
+            if (need_gradients)
+              {
+                const double gradient_difference =
+                  (scratch.exact_gradients[q][c] - scratch.gradients[q][c])
+                    .norm_square() *
+                  JxW;
+                copy.h1_seminorm_squared[g] += gradient_difference;
+                h1_seminorm_squared += gradient_difference;
+              }
+
+            if (residual_estimator)
+              residual_squared +=
+                scratch.residuals[q][c] * scratch.residuals[q][c] * JxW;
+          }
+      }
+
+    if (exact_estimator)
+      copy.estimator = std::sqrt(h1_seminorm_squared);
+    else if (dwr_estimator)
+      // (||R||_K + h_K^{-1/2} ||r||_dK) ||z - I_h z||_K，其中estimate()中的
+      // 跳跃项约为 h_K^{1/2} ||r||_dK。每个单元只读写自己的位置。
+      copy.estimator =
+        (std::sqrt(residual_squared) +
+         error_per_cell[copy.cell_index] / cell->diameter()) *
+        dual_weights[copy.cell_index];
+    else if (residual_estimator)
+      copy.estimator = cell->diameter() * std::sqrt(residual_squared);
+  };
+
+  std::vector<double> l2_squared(n_groups);
+  std::vector<double> h1_seminorm_squared(n_groups);
+  std::vector<double> linfty(n_groups);
+
+  auto copier = [&](const ErrorCopyData &copy) {
+    for (unsigned int g = 0; g < n_groups; ++g)
+      {
+        l2_squared[g] += copy.l2_squared[g];
+        h1_seminorm_squared[g] += copy.h1_seminorm_squared[g];
+        linfty[g] = std::max(linfty[g], copy.linfty[g]);
+      }
+    if (dwr_estimator)
+      error_per_cell[copy.cell_index] = copy.estimator;
+    else if (compute_estimator)
+      error_per_cell[copy.cell_index] += copy.estimator;
+  };
+
+  using CellFilter =
+    FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>;
+
+  WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                             dof_handler.begin_active()),
+                  CellFilter(IteratorFilters::LocallyOwnedCell(),
+                             dof_handler.end()),
+                  worker,
+                  copier,
+                  sample_scratch,
+                  sample_copy);
+
+  std::vector<double> global_l2_squared(n_groups);
+  std::vector<double> global_h1_seminorm_squared(n_groups);
+  std::vector<double> global_linfty(n_groups);
+  Utilities::MPI::sum(l2_squared, mpi_communicator, global_l2_squared);
+  Utilities::MPI::sum(h1_seminorm_squared,
+                      mpi_communicator,
+                      global_h1_seminorm_squared);
+  Utilities::MPI::max(linfty, mpi_communicator, global_linfty);
+
+  auto &table = current_error_table();
+  latest_errors.clear();
+  for (unsigned int g = 0; g < n_groups; ++g)
+    for (const auto &norm : error_norms)
+      {
+        double error = 0;
+        switch (norm)
+          {
+            case VectorTools::L2_norm:
+              error = std::sqrt(global_l2_squared[g]);
+              break;
+            case VectorTools::H1_seminorm:
+              error = std::sqrt(global_h1_seminorm_squared[g]);
+              break;
+            case VectorTools::H1_norm:
+              error = std::sqrt(global_l2_squared[g] +
+                                global_h1_seminorm_squared[g]);
+              break;
+            case VectorTools::Linfty_norm:
+              error = global_linfty[g];
+              break;
+            default:
+              AssertThrow(false, ExcNotImplemented());
+          }
+        const auto name =
+          group_names[g] + "_" + Patterns::Tools::to_string(norm);
+        latest_errors[name] = error;
+        table.add_extra_column(name, [error]() { return error; });
+      }
+
+  // dwr的 η_K 是 |J(e)| 的上界中的各项，直接相加；其他估计器取平方和的根
+  const double global_estimator =
+    estimator_type == "dwr" ?
+      Utilities::MPI::sum(error_per_cell.l1_norm(), mpi_communicator) :
+      std::sqrt(
+        Utilities::MPI::sum(error_per_cell.norm_sqr(), mpi_communicator));
+  latest_errors["estimator"] = global_estimator;
+  table.add_extra_column("estimator",
+                         [global_estimator]() { return global_estimator; });
+
+  // 所有的范数都已经计算好了。表格只添加cells、dofs和额外的列。
+  table.error_from_exact(*mapping, dof_handler, solution, exact_solution);
 }
 
 
@@ -438,6 +2267,36 @@ BaseProblem<dim>::mark()
     {
       Assert(false, ExcInternalError());
     }
+
+  if (use_hp)
+    {
+      // 在标记为h加密（粗化）的单元中，把解最光滑的一部分改为p加密（p粗化）
+      Vector<float> smoothness(triangulation.n_active_cells());
+      if (smoothness_estimator == "legendre")
+        {
+          if (!legendre)
+            legendre = std::make_unique<FESeries::Legendre<dim>>(
+              SmoothnessEstimator::Legendre::default_fe_series(
+                fe_collection));
+          SmoothnessEstimator::Legendre::coefficient_decay(
+            *legendre, dof_handler, locally_relevant_solution, smoothness);
+        }
+      else
+        {
+          if (!fourier)
+            fourier = std::make_unique<FESeries::Fourier<dim>>(
+              SmoothnessEstimator::Fourier::default_fe_series(fe_collection));
+          SmoothnessEstimator::Fourier::coefficient_decay(
+            *fourier, dof_handler, locally_relevant_solution, smoothness);
+        }
+
+      hp::Refinement::p_adaptivity_fixed_number(
+        dof_handler,
+        smoothness,
+        p_refinement_and_coarsening_fractions.first,
+        p_refinement_and_coarsening_fractions.second);
+      hp::Refinement::choose_p_over_h(dof_handler);
+    }
 }
 
 
@@ -462,6 +2321,9 @@ template <int dim>
 void
 BaseProblem<dim>::output_results(const unsigned cycle) const
 {
+  if (output_format == "none")
+    return;
+
   TimerOutput::Scope    timer_section(timer, "output_results");
   DataOut<dim>          data_out;
   DataOutBase::VtkFlags flags;
@@ -471,10 +2333,24 @@ BaseProblem<dim>::output_results(const unsigned cycle) const
   // Attach to this signal to output more stuff
   add_data_vector(data_out);
   data_out.add_data_vector(error_per_cell, "estimator");
+
+  Vector<float> fe_degrees;
+  if (use_hp)
+    {
+      fe_degrees.reinit(triangulation.n_active_cells());
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        if (cell->is_locally_owned())
+          fe_degrees[cell->active_cell_index()] = cell->get_fe().degree;
+      data_out.add_data_vector(fe_degrees, "fe_degree");
+    }
+
   data_out.build_patches(*mapping,
-                         std::max(mapping_degree, fe->degree),
+                         std::max(mapping_degree, fe_collection.max_degree()),
                          DataOut<dim>::curved_inner_cells);
-  std::string fname = output_filename + "_" + std::to_string(cycle) + ".vtu";
+  std::string fname = output_filename + "_" + std::to_string(cycle);
+  if (current_load_case != numbers::invalid_unsigned_int)
+    fname += "_case" + std::to_string(current_load_case);
+  fname += ".vtu";
   data_out.write_vtu_in_parallel(fname, mpi_communicator);
 
   GridOut go;
@@ -488,12 +2364,197 @@ BaseProblem<dim>::output_results(const unsigned cycle) const
 
 template <int dim>
 void
-BaseProblem<dim>::print_system_info()
+BaseProblem<dim>::diagnostics(const unsigned int cycle)
+{
+  write_diagnostics(locally_relevant_solution, cycle);
+}
+
+
+
+namespace
+{
+  /**
+   * 在`points`上计算`solution`的所有分量。n_components必须在编译时已知。
+   */
+  template <int n_components, int dim, typename VectorType>
+  std::vector<Vector<double>>
+  point_values(Utilities::MPI::RemotePointEvaluation<dim> &evaluation,
+               const DoFHandler<dim> &                     dof_handler,
+               const VectorType &                          solution)
+  {
+    const auto values =
+      VectorTools::point_values<n_components>(evaluation,
+                                              dof_handler,
+                                              solution);
+
+    std::vector<Vector<double>> result(values.size(),
+                                       Vector<double>(n_components));
+    for (unsigned int i = 0; i < values.size(); ++i)
+      for (unsigned int c = 0; c < n_components; ++c)
+        {
+          if constexpr (n_components == 1)
+            result[i][c] = values[i];
+          else
+            result[i][c] = values[i][c];
+        }
+    return result;
+  }
+} // namespace
+
+
+
+template <int dim>
+template <typename VectorType>
+void
+BaseProblem<dim>::write_diagnostics(const VectorType & solution,
+                                    const unsigned int cycle)
 {
-  if (number_of_threads != -1 && number_of_threads > 0)
-    MultithreadInfo::set_thread_limit(
-      static_cast<unsigned int>(number_of_threads));
+  if (probe_points.empty() && polylines.empty() &&
+      boundary_integral_ids.empty())
+    return;
+
+  TimerOutput::Scope timer_section(timer, "diagnostics");
+
+  // 所有的探针和折线上的采样点一起定位和计算
+  std::vector<Point<dim>>                          points = probe_points;
+  std::vector<std::pair<std::string, unsigned int>> labels;
+  for (unsigned int i = 0; i < probe_points.size(); ++i)
+    labels.emplace_back("probe", i);
+  for (unsigned int l = 0; l < polylines.size(); ++l)
+    if (!polylines[l].empty())
+      {
+        // 每一段不包括它的终点，最后一个顶点单独加上
+        for (unsigned int v = 0; v + 1 < polylines[l].size(); ++v)
+          for (unsigned int k = 0; k < points_per_polyline_segment; ++k)
+            {
+              const double t = double(k) / points_per_polyline_segment;
+              points.push_back((1 - t) * polylines[l][v] +
+                               t * polylines[l][v + 1]);
+              labels.emplace_back("polyline", l);
+            }
+        points.push_back(polylines[l].back());
+        labels.emplace_back("polyline", l);
+      }
+
+  std::vector<Vector<double>> values;
+  if (!points.empty())
+    {
+      // 定位采样点需要搜索所有进程上的单元，只在网格或采样点改变后进行
+      if (!diagnostic_evaluation || !diagnostic_evaluation_is_current ||
+          points != diagnostic_points)
+        {
+          if (!diagnostic_evaluation)
+            diagnostic_evaluation =
+              std::make_unique<Utilities::MPI::RemotePointEvaluation<dim>>();
+          diagnostic_evaluation->reinit(points, triangulation, *mapping);
+          AssertThrow(diagnostic_evaluation->all_points_found(),
+                      ExcMessage("Some diagnostic points are outside of the "
+                                 "domain."));
+          diagnostic_points                = points;
+          diagnostic_evaluation_is_current = true;
+        }
 
+      auto &evaluation = *diagnostic_evaluation;
+      if (n_components == 1)
+        values = point_values<1>(evaluation, dof_handler, solution);
+      else if (n_components == dim)
+        values = point_values<dim>(evaluation, dof_handler, solution);
+      else if (n_components == dim + 1)
+        values = point_values<dim + 1>(evaluation, dof_handler, solution);
+      else
+        AssertThrow(false, ExcNotImplemented());
+    }
+
+  // 每个边界上各个分量的积分以及边界的面积
+  std::vector<double> integrals;
+  if (!boundary_integral_ids.empty())
+    {
+      hp::QCollection<dim - 1> face_quadrature;
+      for (unsigned int i = 0; i < fe_collection.size(); ++i)
+        face_quadrature.push_back(
+          QGauss<dim - 1>(fe_collection[i].degree + 1));
+      hp::FEFaceValues<dim> hp_fe_face_values(*mapping,
+                                              fe_collection,
+                                              face_quadrature,
+                                              update_values |
+                                                update_JxW_values);
+
+      integrals.resize(boundary_integral_ids.size() * (n_components + 1));
+      std::vector<Vector<double>> face_values;
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        if (cell->is_locally_owned() && cell->at_boundary())
+          for (const auto f : cell->face_indices())
+            if (cell->face(f)->at_boundary() &&
+                boundary_integral_ids.count(cell->face(f)->boundary_id()))
+              {
+                const unsigned int b = std::distance(
+                  boundary_integral_ids.begin(),
+                  boundary_integral_ids.find(cell->face(f)->boundary_id()));
+                hp_fe_face_values.reinit(cell, f);
+                const auto &fe_face_values =
+                  hp_fe_face_values.get_present_fe_values();
+                face_values.resize(fe_face_values.n_quadrature_points,
+                                   Vector<double>(n_components));
+                fe_face_values.get_function_values(solution, face_values);
+
+                double *integral = &integrals[b * (n_components + 1)];
+                for (const auto q : fe_face_values.quadrature_point_indices())
+                  {
+                    for (unsigned int c = 0; c < n_components; ++c)
+                      integral[c] += face_values[q][c] * fe_face_values.JxW(q);
+                    integral[n_components] += fe_face_values.JxW(q);
+                  }
+              }
+      Utilities::MPI::sum(integrals, mpi_communicator, integrals);
+    }
+
+  if (Utilities::MPI::this_mpi_process(mpi_communicator) != 0)
+    return;
+
+  std::string fname = diagnostics_filename + "_" + std::to_string(cycle);
+  if (current_load_case != numbers::invalid_unsigned_int)
+    fname += "_case" + std::to_string(current_load_case);
+  std::ofstream out(fname + ".csv");
+  AssertThrow(out, ExcFileNotOpen(fname + ".csv"));
+  out.precision(12);
+
+  const char *coordinate_names[] = {"x", "y", "z"};
+  out << "kind,index";
+  for (unsigned int d = 0; d < dim; ++d)
+    out << "," << coordinate_names[d];
+  for (unsigned int c = 0; c < n_components; ++c)
+    out << "," << error_component_names[c] << c;
+  out << ",measure" << std::endl;
+
+  for (unsigned int i = 0; i < points.size(); ++i)
+    {
+      out << labels[i].first << "," << labels[i].second;
+      for (unsigned int d = 0; d < dim; ++d)
+        out << "," << points[i][d];
+      for (unsigned int c = 0; c < n_components; ++c)
+        out << "," << values[i][c];
+      out << "," << std::endl;
+    }
+
+  unsigned int b = 0;
+  for (const auto id : boundary_integral_ids)
+    {
+      out << "boundary," << id;
+      for (unsigned int d = 0; d < dim; ++d)
+        out << ",";
+      for (unsigned int c = 0; c <= n_components; ++c)
+        out << "," << integrals[b * (n_components + 1) + c];
+      out << std::endl;
+      ++b;
+    }
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::print_system_info()
+{
   pcout << "Number of cores        : " << MultithreadInfo::n_cores()
         << std::endl
         << "Number of threads      : " << MultithreadInfo::n_threads()
@@ -510,15 +2571,56 @@ template <int dim>
 void
 BaseProblem<dim>::run()
 {
+  startup_timer.restart();
   print_system_info();
   make_grid();
+  run_refinement_cycles();
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::run_refinement_cycles()
+{
   for (unsigned int cycle = 0; cycle < n_refinement_cycles; ++cycle)
     {
-      setup_system();
-      assemble_system();
-      solve();
-      estimate();
-      output_results(cycle);
+      if (cycle == 0 && reuse_system)
+        {
+          // 矩阵和提升项都来自上一次运行
+          pcout << "Reusing linear system of previous run" << std::endl;
+          initialize_functions();
+          if (n_load_cases() > 0)
+            set_load_case(0);
+          assemble_rhs();
+          system_rhs += lift;
+        }
+      else
+        {
+          setup_system();
+          if (n_load_cases() > 0)
+            set_load_case(0);
+          assemble_system();
+          if (report_matrix_statistics)
+            print_matrix_statistics();
+
+          // 集成模式中之后的运行可能只改变右手边。荷载工况的提升项
+          // 在solve_load_cases()中计算。
+          if (run_error_table && n_load_cases() == 0)
+            compute_lift();
+        }
+
+      if (n_load_cases() > 0)
+        solve_load_cases(cycle);
+      else
+        {
+          solve();
+          if (cycle == 0)
+            print_startup_statistics();
+          estimate();
+          output_results(cycle);
+          diagnostics(cycle);
+        }
       if (cycle < n_refinement_cycles - 1)
         {
           mark();
@@ -526,9 +2628,216 @@ BaseProblem<dim>::run()
         }
     }
   if (pcout.is_active())
-    error_table.output_table(std::cout);
+    {
+      if (n_load_cases() > 0)
+        for (unsigned int i = 0; i < load_case_error_tables.size(); ++i)
+          {
+            std::cout << "Load case " << i << std::endl;
+            load_case_error_tables[i].output_table(std::cout);
+          }
+      else
+        current_error_table().output_table(std::cout);
+    }
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::print_startup_statistics() const
+{
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats(stats);
+  const auto memory =
+    Utilities::MPI::min_max_avg(stats.VmRSS / 1024., mpi_communicator);
+
+  pcout << "Time to first solve    : " << startup_timer.wall_time() << " s"
+        << std::endl
+        << "Memory per process (MB): min " << memory.min << ", avg "
+        << memory.avg << ", max " << memory.max << std::endl;
+}
+
+
+
+template <int dim>
+void
+BaseProblem<dim>::run_ensemble(const std::string &sweep_filename)
+{
+  std::ifstream sweep_file(sweep_filename);
+  AssertThrow(sweep_file, ExcFileNotOpen(sweep_filename));
+
+  // 读取扫描文件：每一行是一个参数路径和它的所有取值
+  std::vector<std::string>              keys;
+  std::vector<std::vector<std::string>> values;
+  bool                                  zip = false;
+  std::string                           line;
+  while (std::getline(sweep_file, line))
+    {
+      line = Utilities::trim(line.substr(0, line.find('#')));
+      if (line.empty())
+        continue;
+      const auto pos = line.find('=');
+      AssertThrow(pos != std::string::npos,
+                  ExcMessage("Invalid line in sweep file: " + line));
+      const auto key   = Utilities::trim(line.substr(0, pos));
+      const auto value = line.substr(pos + 1);
+      if (key == "mode")
+        {
+          AssertThrow(Utilities::trim(value) == "zip" ||
+                        Utilities::trim(value) == "product",
+                      ExcMessage("Sweep mode must be zip or product."));
+          zip = (Utilities::trim(value) == "zip");
+          continue;
+        }
+      keys.push_back(key);
+      values.push_back(Utilities::split_string_list(value, '|'));
+    }
+
+  unsigned int n_runs = keys.empty() ? 1 : (zip ? values[0].size() : 1);
+  for (const auto &v : values)
+    {
+      if (zip)
+        AssertThrow(v.size() == n_runs,
+                    ExcMessage("All lines must have the same number of "
+                               "values in zip mode."));
+      else
+        n_runs *= v.size();
+    }
+
+  print_system_info();
+
+  // 只影响右手边或输出的参数。只有它们改变时，可以保留上一次运行的线性系统。
+  const std::set<std::string> rhs_parameters = {
+    "Forcing term expression",
+    "Neumann boundary condition expression",
+    "Load case forcing term expressions",
+    "Load case Neumann boundary condition expressions",
+    "Exact solution expression",
+    "Output filename"};
+
+  TableHandler             summary;
+  std::string              previous_grid_key;
+  bool                     grid_is_reusable = false;
+  std::vector<std::string> previous_run_values(keys.size());
+
+  for (unsigned int run_index = 0; run_index < n_runs; ++run_index)
+    {
+      // 把这次运行的取值写成参数文件的格式
+      std::vector<std::string> run_values(keys.size());
+      std::stringstream        str;
+      for (unsigned int k = 0, index = run_index; k < keys.size(); ++k)
+        {
+          if (zip)
+            run_values[k] = values[k][run_index];
+          else
+            {
+              run_values[k] = values[k][index % values[k].size()];
+              index /= values[k].size();
+            }
+
+          const auto path = Utilities::split_string_list(keys[k], '/');
+          for (unsigned int i = 0; i + 1 < path.size(); ++i)
+            str << "subsection " << path[i] << std::endl;
+          str << "set " << path.back() << " = " << run_values[k] << std::endl;
+          for (unsigned int i = 0; i + 1 < path.size(); ++i)
+            str << "end" << std::endl;
+        }
+
+      pcout << "Ensemble run " << run_index + 1 << " of " << n_runs
+            << std::endl;
+      Timer run_timer(mpi_communicator, true);
+      startup_timer.restart();
+
+      parse_string(str.str());
+
+      // error_table本身从不写入，每次运行都从它拷贝出一个新的表格
+      run_error_table = std::make_unique<ParsedConvergenceTable>(error_table);
+      load_case_error_tables.clear();
+
+      // 和上一次运行相比，是否只有右手边和输出相关的参数改变了
+      bool only_rhs_changed = (run_index > 0);
+      for (unsigned int k = 0; k < keys.size(); ++k)
+        if (run_values[k] != previous_run_values[k] &&
+            rhs_parameters.count(
+              Utilities::split_string_list(keys[k], '/').back()) == 0)
+          only_rhs_changed = false;
+      previous_run_values = run_values;
+
+      // 只有网格相关的参数改变时才重新生成网格
+      const std::string grid_key =
+        grid_generator_function + "|" + grid_generator_arguments + "|" +
+        grid_input_file + "|" + pre_refinement_expression + "|" +
+        Patterns::Tools::to_string(constants) + "|" +
+        std::to_string(n_refinements);
+      const bool reuse_grid = grid_is_reusable && grid_key == previous_grid_key;
+      if (reuse_grid)
+        pcout << "Reusing grid of previous run" << std::endl;
+      else
+        {
+          dof_handler.clear();
+          triangulation.clear();
+          make_grid();
+          previous_grid_key = grid_key;
+        }
+
+      // 否则有限元空间、映射和所有函数都会在setup_system()中用新的参数重新创建
+      reuse_system = reuse_grid && only_rhs_changed &&
+                     linear_algebra_backend != "native";
+      if (!reuse_system)
+        fe.reset();
+
+      run_refinement_cycles();
+      grid_is_reusable = (n_refinement_cycles <= 1);
+      run_timer.stop();
+
+      summary.add_value("run", run_index);
+      for (unsigned int k = 0; k < keys.size(); ++k)
+        summary.add_value(keys[k], run_values[k]);
+      summary.add_value("cells", triangulation.n_global_active_cells());
+      summary.add_value("dofs", dof_handler.n_dofs());
+      summary.add_value("estimator",
+                        std::sqrt(Utilities::MPI::sum(
+                          error_per_cell.norm_sqr(), mpi_communicator)));
+      summary.add_value("wall time", run_timer.wall_time());
+      summary.set_scientific("estimator", true);
+    }
+
+  if (pcout.is_active())
+    {
+      std::cout << "Ensemble summary" << std::endl;
+      summary.write_text(std::cout, TableHandler::org_mode_table);
+    }
 }
 
 template class BaseProblem<1>;
 template class BaseProblem<2>;
-template class BaseProblem<3>;
\ No newline at end of file
+template class BaseProblem<3>;
+
+template void
+BaseProblem<1>::evaluate_errors(const LA::MPI::Vector &, const bool);
+template void
+BaseProblem<2>::evaluate_errors(const LA::MPI::Vector &, const bool);
+template void
+BaseProblem<3>::evaluate_errors(const LA::MPI::Vector &, const bool);
+template void
+BaseProblem<1>::evaluate_errors(const LA::MPI::BlockVector &, const bool);
+template void
+BaseProblem<2>::evaluate_errors(const LA::MPI::BlockVector &, const bool);
+template void
+BaseProblem<3>::evaluate_errors(const LA::MPI::BlockVector &, const bool);
+
+template void
+BaseProblem<1>::write_diagnostics(const LA::MPI::Vector &, const unsigned int);
+template void
+BaseProblem<2>::write_diagnostics(const LA::MPI::Vector &, const unsigned int);
+template void
+BaseProblem<3>::write_diagnostics(const LA::MPI::Vector &, const unsigned int);
+template void
+BaseProblem<1>::write_diagnostics(const LA::MPI::BlockVector &,
+                                  const unsigned int);
+template void
+BaseProblem<2>::write_diagnostics(const LA::MPI::BlockVector &,
+                                  const unsigned int);
+template void
+BaseProblem<3>::write_diagnostics(const LA::MPI::BlockVector &,
+                                  const unsigned int);
\ No newline at end of file
@@ -0,0 +1,411 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+#include "heat_equation.h"
+
+using namespace dealii;
+
+template <int dim>
+HeatEquation<dim>::HeatEquation()
+  : BaseProblem<dim>(1, "HeatEquation<" + std::to_string(dim) + ">")
+{
+  this->time_dependent_functions = true;
+
+  // 边界值随时间变化，不能在时间步之间缓存。热方程中这个参数默认关闭。
+  this->cache_boundary_values = false;
+  this->enter_my_subsection(this->prm);
+  this->prm.set("Cache boundary values", false);
+  this->leave_my_subsection(this->prm);
+
+  this->add_parameter("Initial condition expression",
+                      initial_condition_expression);
+
+  this->enter_subsection("Time stepping");
+  {
+    this->add_parameter("Theta",
+                        theta,
+                        "",
+                        this->prm,
+                        Patterns::Double(0, 1));
+    this->add_parameter("Final time", final_time);
+    this->add_parameter("Initial time step", initial_time_step);
+    this->add_parameter("Minimum time step", minimum_time_step);
+    this->add_parameter("Maximum time step", maximum_time_step);
+    this->add_parameter("Tolerance", time_step_tolerance);
+    this->add_parameter("Refinement interval", refinement_interval);
+    this->add_parameter("Output interval", output_interval);
+  }
+  this->leave_subsection();
+
+  // Output the scalar result.
+  this->add_data_vector.connect([&](auto &data_out) {
+    data_out.add_data_vector(this->locally_relevant_solution, "solution");
+  });
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::set_time(const double time)
+{
+  this->forcing_term.set_time(time);
+  this->exact_solution.set_time(time);
+  this->dirichlet_boundary_condition.set_time(time);
+  this->neumann_boundary_condition.set_time(time);
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::assemble_system()
+{
+  TimerOutput::Scope timer_section(this->timer, "assemble_system");
+
+  // 与system_matrix的稀疏模式相同
+  mass_matrix.reinit(this->system_matrix);
+  stiffness_matrix.reinit(this->system_matrix);
+
+  local_mass_matrices.resize(this->triangulation.n_active_cells());
+  local_stiffness_matrices.resize(this->triangulation.n_active_cells());
+
+  auto &scratch_pool = this->get_assembly_scratch();
+
+  const unsigned int            n_dofs = this->fe->n_dofs_per_cell();
+  MeshWorker::CopyData<2, 1, 1> copy(n_dofs);
+
+  // 不同的单元写入局部矩阵的不同位置，可以在worker中直接保存
+  auto worker = [&](const auto &cell, unsigned int &, auto &copy) {
+    auto &cell_mass      = copy.matrices[0];
+    auto &cell_stiffness = copy.matrices[1];
+    cell->get_dof_indices(copy.local_dof_indices[0]);
+
+    const auto &fe_values = scratch_pool.get()[0].reinit(cell);
+    cell_mass             = 0;
+    cell_stiffness        = 0;
+    for (const unsigned int q_index : fe_values.quadrature_point_indices())
+      for (const unsigned int i : fe_values.dof_indices())
+        for (const unsigned int j : fe_values.dof_indices())
+          {
+            cell_mass(i, j) += fe_values.shape_value(i, q_index) * // phi_i
+                               fe_values.shape_value(j, q_index) * // phi_j
+                               fe_values.JxW(q_index);             // dx
+            cell_stiffness(i, j) +=
+              fe_values.shape_grad(i, q_index) * // grad phi_i
+              fe_values.shape_grad(j, q_index) * // grad phi_j
+              fe_values.JxW(q_index);            // dx
+          }
+
+    local_mass_matrices[cell->active_cell_index()]      = cell_mass;
+    local_stiffness_matrices[cell->active_cell_index()] = cell_stiffness;
+  };
+
+  auto copier = [&](const auto &copy) {
+    this->constraints.distribute_local_to_global(copy.matrices[0],
+                                                 copy.local_dof_indices[0],
+                                                 mass_matrix);
+    this->constraints.distribute_local_to_global(copy.matrices[1],
+                                                 copy.local_dof_indices[0],
+                                                 stiffness_matrix);
+  };
+
+  using CellFilter =
+    FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>;
+
+  WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                             this->dof_handler.begin_active()),
+                  CellFilter(IteratorFilters::LocallyOwnedCell(),
+                             this->dof_handler.end()),
+                  worker,
+                  copier,
+                  0u,
+                  copy);
+
+  mass_matrix.compress(VectorOperation::add);
+  stiffness_matrix.compress(VectorOperation::add);
+
+  // 新的网格上需要重新构造系统矩阵
+  theta_operator.time_step    = 0;
+  embedded_operator.time_step = 0;
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::make_operator(ThetaOperator &op, const double time_step)
+{
+  if (op.time_step == time_step)
+    return;
+
+  TimerOutput::Scope timer_section(this->timer, "make_operator");
+  op.matrix.copy_from(mass_matrix);
+  op.matrix.add(op.theta * time_step, stiffness_matrix);
+
+  op.preconditioner = std::make_unique<LA::MPI::PreconditionAMG>();
+  op.preconditioner->initialize(op.matrix,
+                                this->amg_data(this->dof_handler));
+  op.time_step = time_step;
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::do_time_step(ThetaOperator &op,
+                                const double   time,
+                                const double   time_step)
+{
+  make_operator(op, time_step);
+
+  // 新时刻的Dirichlet边界值。约束的结构不变，所以系统矩阵仍然有效
+  this->dirichlet_boundary_condition.set_time(time + time_step);
+  this->make_constraints(this->locally_relevant_dofs);
+
+  {
+    TimerOutput::Scope timer_section(this->timer, "assemble_rhs");
+    this->system_rhs = 0;
+
+    // 外力项要在两个时刻上计算，FunctionParser的时间不能在线程之间共享
+    auto &scratch = this->get_assembly_scratch().get()[0];
+
+    auto theta_average = [&](FunctionParser<dim> &function,
+                             const Point<dim> &   p) {
+      function.set_time(time);
+      const double old_value = function.value(p);
+      function.set_time(time + time_step);
+      return op.theta * function.value(p) + (1 - op.theta) * old_value;
+    };
+
+    const unsigned int n_dofs = this->fe->n_dofs_per_cell();
+    std::vector<types::global_dof_index> dof_indices(n_dofs);
+    Vector<double>                       old_values(n_dofs);
+    Vector<double>                       cell_rhs(n_dofs);
+    Vector<double>                       stiffness_values(n_dofs);
+    FullMatrix<double>                   cell_matrix(n_dofs, n_dofs);
+
+    for (const auto &cell : this->dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          const unsigned int index          = cell->active_cell_index();
+          const auto &       cell_mass      = local_mass_matrices[index];
+          const auto &       cell_stiffness = local_stiffness_matrices[index];
+
+          cell->get_dof_indices(dof_indices);
+          cell->get_dof_values(this->locally_relevant_solution, old_values);
+
+          // (M - (1-theta) k A) u^{n-1}
+          cell_mass.vmult(cell_rhs, old_values);
+          cell_stiffness.vmult(stiffness_values, old_values);
+          cell_rhs.add(-(1 - op.theta) * time_step, stiffness_values);
+
+          // k (theta f^n + (1-theta) f^{n-1})
+          const auto &fe_values = scratch.reinit(cell);
+          for (const unsigned int q_index :
+               fe_values.quadrature_point_indices())
+            {
+              const double f =
+                theta_average(this->forcing_term,
+                              fe_values.quadrature_point(q_index));
+              for (const unsigned int i : fe_values.dof_indices())
+                cell_rhs(i) += time_step * f *
+                               fe_values.shape_value(i, q_index) *
+                               fe_values.JxW(q_index);
+            }
+
+          if (cell->at_boundary())
+            for (unsigned int f = 0; f < GeometryInfo<dim>::faces_per_cell;
+                 ++f)
+              if (this->neumann_ids.find(cell->face(f)->boundary_id()) !=
+                  this->neumann_ids.end())
+                {
+                  auto &fe_face_values = scratch.reinit(cell, f);
+                  for (const unsigned int q_index :
+                       fe_face_values.quadrature_point_indices())
+                    {
+                      const double g = theta_average(
+                        this->neumann_boundary_condition,
+                        fe_face_values.quadrature_point(q_index));
+                      for (const unsigned int i : fe_face_values.dof_indices())
+                        cell_rhs(i) += time_step * g *
+                                       fe_face_values.shape_value(i, q_index) *
+                                       fe_face_values.JxW(q_index);
+                    }
+                }
+
+          // 局部的系统矩阵只用来把Dirichlet值移到右端项
+          cell_matrix = cell_mass;
+          cell_matrix.add(op.theta * time_step, cell_stiffness);
+          this->constraints.distribute_local_to_global(cell_rhs,
+                                                       dof_indices,
+                                                       this->system_rhs,
+                                                       cell_matrix);
+        }
+    this->system_rhs.compress(VectorOperation::add);
+  }
+
+  TimerOutput::Scope timer_section(this->timer, "solve");
+  this->solution = this->locally_relevant_solution;
+  SolverCG<LA::MPI::Vector> solver(this->solver_control);
+  solver.solve(op.matrix, this->solution, this->system_rhs, *op.preconditioner);
+  this->constraints.distribute(this->solution);
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::refine_mesh()
+{
+  {
+    TimerOutput::Scope timer_section(this->timer, "estimate");
+    const std::map<types::boundary_id, const Function<dim> *> neumann;
+    KellyErrorEstimator<dim>::estimate(*this->mapping,
+                                       this->dof_handler,
+                                       QGauss<dim - 1>(this->fe->degree + 1),
+                                       neumann,
+                                       this->locally_relevant_solution,
+                                       this->error_per_cell);
+  }
+  this->mark();
+
+  parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector> transfer(
+    this->dof_handler);
+  this->triangulation.prepare_coarsening_and_refinement();
+  transfer.prepare_for_coarsening_and_refinement(
+    this->locally_relevant_solution);
+  this->refine_grid();
+
+  this->setup_system();
+  transfer.interpolate(this->solution);
+  this->constraints.distribute(this->solution);
+  this->locally_relevant_solution = this->solution;
+  assemble_system();
+}
+
+
+
+template <int dim>
+void
+HeatEquation<dim>::run()
+{
+  AssertThrow(!this->use_hp && this->linear_algebra_backend != "native",
+              ExcMessage("The heat equation supports neither hp refinement "
+                         "nor the native backend."));
+  AssertThrow(!this->cache_boundary_values,
+              ExcMessage("The boundary values of the heat equation depend on "
+                         "time and cannot be cached. Set \"Cache boundary "
+                         "values\" to false."));
+  AssertThrow(this->estimator_type != "dwr",
+              ExcMessage("The dwr estimator is not implemented for the heat "
+                         "equation."));
+
+  theta_operator.theta    = theta;
+  embedded_operator.theta = theta == 1 ? 0.5 : 1;
+
+  this->startup_timer.restart();
+  this->print_system_info();
+  this->make_grid();
+
+  double time = 0;
+  set_time(time);
+  this->setup_system();
+  assemble_system();
+
+  const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
+  initial_condition.initialize(vars,
+                               initial_condition_expression,
+                               this->constants);
+  VectorTools::interpolate(*this->mapping,
+                           this->dof_handler,
+                           initial_condition,
+                           this->solution);
+  this->constraints.distribute(this->solution);
+  this->locally_relevant_solution = this->solution;
+  this->output_results(0);
+
+  double       time_step = initial_time_step;
+  unsigned int step      = 0;
+  while (final_time - time > 1e-12 * final_time)
+    {
+      time_step = std::min(time_step, final_time - time);
+      do_time_step(theta_operator, time, time_step);
+
+      double next_time_step = time_step;
+      if (time_step_tolerance > 0)
+        {
+          // 两个不同阶的格式之差估计局部误差
+          const LA::MPI::Vector candidate = this->solution;
+          do_time_step(embedded_operator, time, time_step);
+          this->solution -= candidate;
+          const double error = this->solution.linfty_norm() /
+                               (1 + candidate.linfty_norm());
+          this->solution = candidate;
+
+          const double factor =
+            error > 0 ? 0.9 * std::sqrt(time_step_tolerance / error) : 2;
+          // 只有缩小或者明显增大时才改变步长，以便重复使用预条件子
+          if (factor < 1 || factor > 1.25)
+            next_time_step = std::max(
+              minimum_time_step,
+              std::min(maximum_time_step,
+                       time_step * std::max(0.2, std::min(2., factor))));
+
+          if (error > time_step_tolerance && time_step > minimum_time_step)
+            {
+              this->pcout << "Rejected time step " << time_step
+                          << ", error = " << error << std::endl;
+              time_step = next_time_step;
+              continue;
+            }
+        }
+
+      time += time_step;
+      ++step;
+      set_time(time);
+      this->locally_relevant_solution = this->solution;
+      this->pcout << "Time step " << step << ": t = " << time
+                  << ", k = " << time_step << std::endl;
+
+      if (step == 1)
+        this->print_startup_statistics();
+      if (output_interval > 0 && step % output_interval == 0)
+        {
+          this->output_results(step);
+          this->diagnostics(step);
+        }
+      if (refinement_interval > 0 && step % refinement_interval == 0 &&
+          final_time - time > 1e-12 * final_time)
+        refine_mesh();
+
+      time_step = next_time_step;
+    }
+
+  // 终止时刻的误差
+  set_time(time);
+  this->estimate();
+  if (this->pcout.is_active())
+    this->current_error_table().output_table(std::cout);
+}
+
+
+template class HeatEquation<1>;
+template class HeatEquation<2>;
+template class HeatEquation<3>;
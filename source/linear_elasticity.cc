@@ -19,16 +19,54 @@
  */
 #include "linear_elasticity.h"
 
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <regex>
+
 using namespace dealii;
 
 template <int dim>
 LinearElasticity<dim>::LinearElasticity() // 参考step-8
   : BaseProblem<dim>(dim, "LinearElasticity<" + std::to_string(dim) + ">")
   , velocity(0)
+  , initial_displacement(dim)
+  , initial_velocity(dim)
 {
   this->add_parameter("Linear elasticity mu", mu);
   this->add_parameter("Linear elasticity lambda", lambda);
 
+  this->enter_subsection("Explicit dynamics");
+  {
+    this->add_parameter("Enable", explicit_dynamics);
+    this->add_parameter("Density", density);
+    this->add_parameter("Final time", final_time);
+    this->add_parameter("CFL number", cfl_number);
+    this->add_parameter("Output interval", explicit_output_interval);
+    this->add_parameter("Initial displacement expression",
+                        initial_displacement_expression);
+    this->add_parameter("Initial velocity expression",
+                        initial_velocity_expression);
+  }
+  this->leave_subsection();
+
+  this->enter_subsection("Eigenvalue analysis");
+  {
+    this->add_parameter("Enable", eigen_analysis);
+    this->add_parameter("Number of modes", n_modes);
+    this->add_parameter("Eigen solver",
+                        eigen_solver,
+                        "",
+                        this->prm,
+                        Patterns::Selection("lobpcg|shift_invert|arpack"));
+    this->add_parameter("Shift", eigen_shift);
+    this->add_parameter("Tolerance", eigen_tolerance);
+    this->add_parameter("Maximum iterations", eigen_max_iterations);
+    this->add_parameter("Compare with shift-invert",
+                        compare_with_shift_invert);
+  }
+  this->leave_subsection();
+
   // Output the vector result. 参考 19 课， DataOut class 对于多组分输出的处理
   this->add_data_vector.connect([&](auto &data_out) {
     std::vector<std::string> names(
@@ -46,6 +84,20 @@ LinearElasticity<dim>::LinearElasticity() // 参考step-8
                              DataOut<dim>::type_dof_data,
                              interpretation);
   });
+
+  // 特征值分析的模态，只在run_eigen_analysis()之后非空
+  this->add_data_vector.connect([&](auto &data_out) {
+    std::vector<DataComponentInterpretation::DataComponentInterpretation>
+      interpretation(this->n_components,
+                     DataComponentInterpretation::component_is_part_of_vector);
+    for (unsigned int i = 0; i < mode_shapes.size(); ++i)
+      data_out.add_data_vector(mode_shapes[i],
+                               std::vector<std::string>(
+                                 this->n_components,
+                                 "mode_" + std::to_string(i)),
+                               DataOut<dim>::type_dof_data,
+                               interpretation);
+  });
 }
 
 
@@ -68,33 +120,35 @@ LinearElasticity<dim>::assemble_system_one_cell(
 
   for (const unsigned int q_index : fe_values.quadrature_point_indices())
     {
+      if (!this->assemble_rhs_only)
+        for (const unsigned int i : fe_values.dof_indices())
+          {
+            const auto eps_v = fe_values[velocity].symmetric_gradient(
+              i, q_index); // SymmetricTensor<2,dim>
+            const auto div_v = fe_values[velocity].divergence(
+              i, q_index); // double // velocity 为 FEValuesExtractors 类的对象
+
+            for (const unsigned int j : fe_values.dof_indices())
+              {
+                const auto eps_u = fe_values[velocity].symmetric_gradient(
+                  j, q_index); // SymmetricTensor<2,dim>
+                const auto div_u = fe_values[velocity].divergence(
+                  j, q_index); // double \nabla \cdot \phi_{i,u}(x_q)
+
+                cell_matrix(i, j) +=
+                  (mu * scalar_product(eps_v, eps_u) + lambda * div_u * div_v) *
+                  fe_values.JxW(q_index); // dx
+              }
+          }
       for (const unsigned int i : fe_values.dof_indices())
         {
-          const auto eps_v = fe_values[velocity].symmetric_gradient(
-            i, q_index); // SymmetricTensor<2,dim>
-          const auto div_v = fe_values[velocity].divergence(
-            i, q_index); // double // velocity 为 FEValuesExtractors 类的对象
-
-          for (const unsigned int j : fe_values.dof_indices())
-            {
-              const auto eps_u = fe_values[velocity].symmetric_gradient(
-                j, q_index); // SymmetricTensor<2,dim>
-              const auto div_u = fe_values[velocity].divergence(
-                j, q_index); // double \nabla \cdot \phi_{i,u}(x_q)
-
-              cell_matrix(i, j) +=
-                (mu * scalar_product(eps_v, eps_u) + lambda * div_u * div_v) *
-                fe_values.JxW(q_index); // dx
-            }
-          for (const unsigned int i : fe_values.dof_indices())
-            {
-              const auto comp_i = this->fe->system_to_component_index(i).first;
-              cell_rhs(i) +=
-                (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                 this->forcing_term.value(fe_values.quadrature_point(q_index),
-                                          comp_i) * // f(x_q)
-                 fe_values.JxW(q_index));           // dx
-            }
+          const auto comp_i =
+            fe_values.get_fe().system_to_component_index(i).first;
+          cell_rhs(i) +=
+            (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+             this->forcing_term.value(fe_values.quadrature_point(q_index),
+                                      comp_i) * // f(x_q)
+             fe_values.JxW(q_index));           // dx
         }
     }
 
@@ -110,7 +164,7 @@ LinearElasticity<dim>::assemble_system_one_cell(
             for (const unsigned int i : fe_face_values.dof_indices())
               {
                 const auto comp_i =
-                  this->fe->system_to_component_index(i).first;
+                  fe_face_values.get_fe().system_to_component_index(i).first;
                 cell_rhs(i) +=
                   fe_face_values.shape_value(i, q_index) *
                   this->neumann_boundary_condition.value(
@@ -121,6 +175,795 @@ LinearElasticity<dim>::assemble_system_one_cell(
 }
 
 
+
+template <int dim>
+TrilinosWrappers::PreconditionAMG::AdditionalData
+LinearElasticity<dim>::amg_data(const DoFHandler<dim> &dofs) const
+{
+  auto data = BaseProblem<dim>::amg_data(dofs);
+
+  // 刚体模态包含了按分量的常数模态（平移），另外还有转动
+  data.constant_modes.clear();
+  data.constant_modes_values =
+    DoFTools::extract_rigid_body_modes(*this->mapping, dofs);
+  return data;
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::compute_strong_residual(
+  const FEValues<dim> &        fe_values,
+  const Vector<double> &       local_dof_values,
+  std::vector<Vector<double>> &residuals) const
+{
+  // f + div(mu eps(u) + lambda div(u) I)，其中
+  // div(eps(u))_i = (Delta u_i + d_i div(u)) / 2
+  this->forcing_term.vector_value_list(fe_values.get_quadrature_points(),
+                                       residuals);
+  const auto &fe = fe_values.get_fe();
+  for (const auto q : fe_values.quadrature_point_indices())
+    {
+      std::array<Tensor<2, dim>, dim> hessians;
+      for (const unsigned int i : fe_values.dof_indices())
+        hessians[fe.system_to_component_index(i).first] +=
+          local_dof_values(i) * fe_values.shape_hessian(i, q);
+
+      Tensor<1, dim> grad_div;
+      for (unsigned int d = 0; d < dim; ++d)
+        for (unsigned int c = 0; c < dim; ++c)
+          grad_div[d] += hessians[c][d][c];
+
+      for (unsigned int c = 0; c < dim; ++c)
+        residuals[q](c) += 0.5 * mu * (trace(hessians[c]) + grad_div[c]) +
+                           lambda * grad_div[c];
+    }
+}
+
+
+
+namespace
+{
+  /**
+   * 表达式中是否出现了时间变量`t`。
+   */
+  bool
+  depends_on_time(const std::string &expression)
+  {
+    static const std::regex time_variable(
+      "(^|[^A-Za-z0-9_])t($|[^A-Za-z0-9_])");
+    return std::regex_search(expression, time_variable);
+  }
+
+
+
+  /**
+   * 在`p`的每一个向量化分量上计算`function`，结果的类型与FEEvaluation的值相同。
+   */
+  template <int dim, typename ValueType>
+  ValueType
+  evaluate_function(const Function<dim> &                       function,
+                    const Point<dim, VectorizedArray<double>> &p)
+  {
+    ValueType value;
+    for (unsigned int v = 0; v < VectorizedArray<double>::size(); ++v)
+      {
+        Point<dim> point;
+        for (unsigned int d = 0; d < dim; ++d)
+          point[d] = p[d][v];
+        if constexpr (dim == 1)
+          value[v] = function.value(point);
+        else
+          for (unsigned int c = 0; c < dim; ++c)
+            value[c][v] = function.value(point, c);
+      }
+    return value;
+  }
+} // namespace
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::setup_explicit_dynamics()
+{
+  TimerOutput::Scope timer_section(this->timer, "setup_explicit_dynamics");
+  const unsigned int degree = this->fe->degree;
+  AssertThrow(this->fe->n_base_elements() == 1 &&
+                dynamic_cast<const FE_Q<dim> *>(
+                  &this->fe->base_element(0)) != nullptr,
+              ExcMessage("Explicit dynamics needs FESystem[FE_Q(p)^dim], "
+                         "whose support points are the Gauss-Lobatto "
+                         "points."));
+
+  typename MatrixFree<dim, double>::AdditionalData additional_data;
+  additional_data.mapping_update_flags =
+    update_values | update_gradients | update_JxW_values |
+    update_quadrature_points;
+  if (!this->neumann_ids.empty())
+    additional_data.mapping_update_flags_boundary_faces =
+      update_values | update_JxW_values | update_quadrature_points;
+
+  const std::vector<const DoFHandler<dim> *> dof_handlers = {
+    &this->dof_handler};
+  const std::vector<const AffineConstraints<double> *> constraints = {
+    &this->constraints};
+  const std::vector<Quadrature<1>> quadratures = {
+    QGauss<1>(degree + 1), QGaussLobatto<1>(degree + 1)};
+  matrix_free.reinit(*this->mapping,
+                     dof_handlers,
+                     constraints,
+                     quadratures,
+                     additional_data);
+
+  using FEEval = FEEvaluation<dim, -1, 0, dim, double>;
+
+  // Gauss-Lobatto积分点与支撑点重合，质量矩阵是对角的，等于它作用在1上的结果
+  VectorType ones;
+  matrix_free.initialize_dof_vector(ones);
+  matrix_free.initialize_dof_vector(inverse_lumped_mass);
+  ones = 1;
+  matrix_free.cell_loop(
+    std::function<void(const MatrixFree<dim, double> &,
+                       VectorType &,
+                       const VectorType &,
+                       const std::pair<unsigned int, unsigned int> &)>(
+      [&](const auto &data, auto &dst, const auto &src, const auto &range) {
+        FEEval phi(data, 0, 1);
+        for (unsigned int cell = range.first; cell < range.second; ++cell)
+          {
+            phi.reinit(cell);
+            phi.read_dof_values_plain(src);
+            phi.evaluate(EvaluationFlags::values);
+            for (const unsigned int q : phi.quadrature_point_indices())
+              phi.submit_value(density * phi.get_value(q), q);
+            phi.integrate(EvaluationFlags::values);
+            phi.distribute_local_to_global(dst);
+          }
+      }),
+    inverse_lumped_mass,
+    ones,
+    true);
+  for (unsigned int i = 0; i < inverse_lumped_mass.locally_owned_size(); ++i)
+    inverse_lumped_mass.local_element(i) =
+      inverse_lumped_mass.local_element(i) > 0 ?
+        1. / inverse_lumped_mass.local_element(i) :
+        0.;
+
+  matrix_free.initialize_dof_vector(load_vector);
+  assemble_load_vector(0);
+
+  // 稳定性界限：最小的Gauss-Lobatto点距约为h/p^2，除以纵波波速
+  double min_cell_size = std::numeric_limits<double>::max();
+  for (const auto &cell : this->triangulation.active_cell_iterators())
+    if (cell->is_locally_owned())
+      min_cell_size = std::min(min_cell_size, cell->minimum_vertex_distance());
+  min_cell_size = Utilities::MPI::min(min_cell_size, this->mpi_communicator);
+
+  const double wave_speed = std::sqrt((lambda + 2 * mu) / density);
+  explicit_time_step =
+    cfl_number * min_cell_size / (wave_speed * degree * degree);
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::assemble_load_vector(const double time)
+{
+  TimerOutput::Scope timer_section(this->timer, "assemble_load_vector");
+  this->forcing_term.set_time(time);
+  this->neumann_boundary_condition.set_time(time);
+
+  using FEEval     = FEEvaluation<dim, -1, 0, dim, double>;
+  using FEFaceEval = FEFaceEvaluation<dim, -1, 0, dim, double>;
+
+  // 源向量不被使用
+  matrix_free.loop(
+    std::function<void(const MatrixFree<dim, double> &,
+                       VectorType &,
+                       const VectorType &,
+                       const std::pair<unsigned int, unsigned int> &)>(
+      [&](const auto &data, auto &dst, const auto &, const auto &range) {
+        FEEval phi(data);
+        for (unsigned int cell = range.first; cell < range.second; ++cell)
+          {
+            phi.reinit(cell);
+            for (const unsigned int q : phi.quadrature_point_indices())
+              phi.submit_value(
+                evaluate_function<dim, decltype(phi.get_value(0))>(
+                  this->forcing_term, phi.quadrature_point(q)),
+                q);
+            phi.integrate(EvaluationFlags::values);
+            phi.distribute_local_to_global(dst);
+          }
+      }),
+    std::function<void(const MatrixFree<dim, double> &,
+                       VectorType &,
+                       const VectorType &,
+                       const std::pair<unsigned int, unsigned int> &)>(
+      [](const auto &, auto &, const auto &, const auto &) {}),
+    std::function<void(const MatrixFree<dim, double> &,
+                       VectorType &,
+                       const VectorType &,
+                       const std::pair<unsigned int, unsigned int> &)>(
+      [&](const auto &data, auto &dst, const auto &, const auto &range) {
+        FEFaceEval phi(data, true);
+        for (unsigned int face = range.first; face < range.second; ++face)
+          if (this->neumann_ids.find(data.get_boundary_id(face)) !=
+              this->neumann_ids.end())
+            {
+              phi.reinit(face);
+              for (const unsigned int q : phi.quadrature_point_indices())
+                phi.submit_value(
+                  evaluate_function<dim, decltype(phi.get_value(0))>(
+                    this->neumann_boundary_condition,
+                    phi.quadrature_point(q)),
+                  q);
+              phi.integrate(EvaluationFlags::values);
+              phi.distribute_local_to_global(dst);
+            }
+      }),
+    load_vector,
+    inverse_lumped_mass,
+    true);
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::apply_stiffness(VectorType &      dst,
+                                       const VectorType &src) const
+{
+  matrix_free.cell_loop(
+    std::function<void(const MatrixFree<dim, double> &,
+                       VectorType &,
+                       const VectorType &,
+                       const std::pair<unsigned int, unsigned int> &)>(
+      [&](const auto &data, auto &out, const auto &in, const auto &range) {
+        FEEvaluation<dim, -1, 0, dim, double> phi(data);
+        for (unsigned int cell = range.first; cell < range.second; ++cell)
+          {
+            phi.reinit(cell);
+            // 受约束的自由度上直接使用向量中的值，包括非齐次的Dirichlet值
+            phi.read_dof_values_plain(in);
+            phi.evaluate(EvaluationFlags::gradients);
+            for (const unsigned int q : phi.quadrature_point_indices())
+              {
+                if constexpr (dim == 1)
+                  phi.submit_gradient((mu + lambda) * phi.get_gradient(q), q);
+                else
+                  {
+                    // mu eps(u) + lambda div(u) I
+                    const auto eps    = phi.get_symmetric_gradient(q);
+                    const auto div    = trace(eps);
+                    auto       stress = mu * eps;
+                    for (unsigned int d = 0; d < dim; ++d)
+                      stress[d][d] += lambda * div;
+                    phi.submit_symmetric_gradient(stress, q);
+                  }
+              }
+            phi.integrate(EvaluationFlags::gradients);
+            phi.distribute_local_to_global(out);
+          }
+      }),
+    dst,
+    src,
+    true);
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::compute_acceleration(
+  VectorType &      acceleration,
+  const VectorType &displacement) const
+{
+  apply_stiffness(acceleration, displacement);
+  acceleration.sadd(-1., 1., load_vector);
+  acceleration.scale(inverse_lumped_mass);
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::run()
+{
+  if (explicit_dynamics)
+    run_explicit_dynamics();
+  else if (eigen_analysis)
+    run_eigen_analysis();
+  else
+    BaseProblem<dim>::run();
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::assemble_mass_matrix()
+{
+  TimerOutput::Scope timer_section(this->timer, "assemble_mass_matrix");
+  mass_matrix.reinit(this->system_matrix);
+  mass_matrix = 0;
+  shifted_solver.reset();
+
+  const QGauss<dim>  quadrature(this->fe->degree + 1);
+  FEValues<dim>      fe_values(*this->mapping,
+                               *this->fe,
+                               quadrature,
+                               update_values | update_JxW_values);
+  const unsigned int dofs_per_cell = this->fe->n_dofs_per_cell();
+  FullMatrix<double> cell_mass(dofs_per_cell, dofs_per_cell);
+
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
+
+  for (const auto &cell : this->dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      {
+        fe_values.reinit(cell);
+        cell_mass = 0;
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
+          for (const unsigned int i : fe_values.dof_indices())
+            {
+              const auto comp_i = this->fe->system_to_component_index(i).first;
+              for (const unsigned int j : fe_values.dof_indices())
+                if (this->fe->system_to_component_index(j).first == comp_i)
+                  cell_mass(i, j) += density *
+                                     fe_values.shape_value(i, q_index) *
+                                     fe_values.shape_value(j, q_index) *
+                                     fe_values.JxW(q_index);
+            }
+        cell->get_dof_indices(dof_indices);
+        this->constraints.distribute_local_to_global(cell_mass,
+                                                     dof_indices,
+                                                     mass_matrix);
+      }
+  mass_matrix.compress(VectorOperation::add);
+}
+
+
+
+template <int dim>
+std::vector<LA::MPI::Vector>
+LinearElasticity<dim>::initial_mode_guesses(const unsigned int n) const
+{
+  std::vector<LA::MPI::Vector> vectors(
+    n, LA::MPI::Vector(this->locally_owned_dofs, this->mpi_communicator));
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      // 由全局编号得到的伪随机数
+      for (const auto index : this->locally_owned_dofs)
+        {
+          const std::uint64_t hash =
+            (index + 1) * 2654435761ull + (i + 1) * 40503ull;
+          vectors[i][index] = static_cast<double>(hash % 2048) / 1024. - 1.;
+        }
+      vectors[i].compress(VectorOperation::insert);
+      this->constraints.set_zero(vectors[i]);
+    }
+  return vectors;
+}
+
+
+
+template <int dim>
+TrilinosWrappers::SolverDirect &
+LinearElasticity<dim>::shift_invert_factorization()
+{
+  TimerOutput::Scope timer_section(this->timer, "factorize");
+  const TrilinosWrappers::SolverDirect::AdditionalData data(
+    false, this->direct_solver_type);
+  if (eigen_shift == 0)
+    {
+      if (!this->direct_solver)
+        {
+          this->direct_solver =
+            std::make_unique<TrilinosWrappers::SolverDirect>(
+              this->solver_control, data);
+          this->direct_solver->initialize(this->system_matrix);
+        }
+      return *this->direct_solver;
+    }
+
+  if (!shifted_solver)
+    {
+      shifted_matrix.copy_from(this->system_matrix);
+      shifted_matrix.add(-eigen_shift, mass_matrix);
+      shifted_solver =
+        std::make_unique<TrilinosWrappers::SolverDirect>(this->solver_control,
+                                                         data);
+      shifted_solver->initialize(shifted_matrix);
+    }
+  return *shifted_solver;
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::solve_lobpcg(std::vector<double> &         values,
+                                    std::vector<LA::MPI::Vector> &modes)
+{
+  TimerOutput::Scope timer_section(this->timer, "lobpcg");
+  if (!this->amg)
+    {
+      TimerOutput::Scope timer_section(this->timer, "setup_amg");
+      this->amg = std::make_unique<LA::MPI::PreconditionAMG>();
+      this->amg->initialize(this->system_matrix,
+                            amg_data(this->dof_handler));
+    }
+
+  // 受约束的自由度上为零的向量构成凝聚后的子空间
+  SolverControl                 control(eigen_max_iterations, eigen_tolerance);
+  SolverLOBPCG<LA::MPI::Vector> solver(control);
+  solver.solve(this->system_matrix,
+               mass_matrix,
+               *this->amg,
+               values,
+               modes,
+               [&](LA::MPI::Vector &v) { this->constraints.set_zero(v); });
+  this->pcout << "LOBPCG: " << control.last_step() << " iterations"
+              << std::endl;
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::solve_shift_invert(std::vector<double> &values,
+                                          std::vector<LA::MPI::Vector> &modes)
+{
+  TimerOutput::Scope timer_section(this->timer, "shift_invert");
+  using Solver = SolverLOBPCG<LA::MPI::Vector>;
+
+  auto &             factorization = shift_invert_factorization();
+  const unsigned int n             = modes.size();
+  const unsigned int block_size    = std::min(2 * n, n + 8);
+
+  auto                         X = initial_mode_guesses(block_size);
+  std::vector<LA::MPI::Vector> AX(X), BX(X), Y(X), AY(X), BY(X);
+
+  std::vector<const LA::MPI::Vector *> S, AS, BS;
+  for (unsigned int i = 0; i < block_size; ++i)
+    {
+      S.push_back(&Y[i]);
+      AS.push_back(&AY[i]);
+      BS.push_back(&BY[i]);
+    }
+
+  SolverControl        control(eigen_max_iterations, eigen_tolerance);
+  SolverControl::State state = SolverControl::iterate;
+  std::vector<double>  ritz_values;
+  FullMatrix<double>   coefficients;
+  for (unsigned int it = 0; state == SolverControl::iterate; ++it)
+    {
+      // Y = (K - sigma M)^{-1} M X
+      for (unsigned int i = 0; i < block_size; ++i)
+        {
+          mass_matrix.vmult(BX[i], X[i]);
+          this->constraints.set_zero(BX[i]);
+          factorization.solve(Y[i], BX[i]);
+          this->system_matrix.vmult(AY[i], Y[i]);
+          mass_matrix.vmult(BY[i], Y[i]);
+        }
+      Solver::rayleigh_ritz(S, AS, BS, block_size, ritz_values, coefficients);
+      for (unsigned int i = 0; i < block_size; ++i)
+        {
+          Solver::combine(S, coefficients, i, 0, X[i]);
+          Solver::combine(AS, coefficients, i, 0, AX[i]);
+          Solver::combine(BS, coefficients, i, 0, BX[i]);
+        }
+
+      // 只检查所求的模态，残差暂时存放在Y中
+      std::vector<std::pair<const LA::MPI::Vector *, const LA::MPI::Vector *>>
+        pairs;
+      for (unsigned int i = 0; i < n; ++i)
+        {
+          Y[i] = AX[i];
+          Y[i].add(-ritz_values[i], BX[i]);
+          pairs.emplace_back(&Y[i], &Y[i]);
+          pairs.emplace_back(&BX[i], &BX[i]);
+        }
+      const auto norms        = Solver::inner_products(pairs);
+      double     max_residual = 0;
+      for (unsigned int i = 0; i < n; ++i)
+        max_residual = std::max(max_residual,
+                                std::sqrt(norms[2 * i] / norms[2 * i + 1]) /
+                                  std::max(std::abs(ritz_values[i]), 1e-300));
+      state = control.check(it, max_residual);
+    }
+  AssertThrow(state == SolverControl::success,
+              SolverControl::NoConvergence(control.last_step(),
+                                           control.last_value()));
+
+  values.assign(ritz_values.begin(), ritz_values.begin() + n);
+  for (unsigned int i = 0; i < n; ++i)
+    modes[i] = X[i];
+  this->pcout << "Shift-invert: " << control.last_step() << " iterations"
+              << std::endl;
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::solve_arpack(std::vector<double> &         values,
+                                    std::vector<LA::MPI::Vector> &modes)
+{
+#ifdef DEAL_II_ARPACK_WITH_PARPACK
+  TimerOutput::Scope timer_section(this->timer, "arpack");
+
+  // (K - sigma M)^{-1}，受约束的自由度上为零
+  struct ShiftInvertOperator
+  {
+    void
+    vmult(LA::MPI::Vector &dst, const LA::MPI::Vector &src) const
+    {
+      rhs = src;
+      constraints.set_zero(rhs);
+      factorization.solve(dst, rhs);
+    }
+
+    TrilinosWrappers::SolverDirect & factorization;
+    const AffineConstraints<double> &constraints;
+    mutable LA::MPI::Vector          rhs;
+  } inverse{shift_invert_factorization(), this->constraints, modes[0]};
+
+  using Solver         = PArpackSolver<LA::MPI::Vector>;
+  const unsigned int n = modes.size();
+  const typename Solver::AdditionalData data(std::max(2 * n + 1, 20u),
+                                             Solver::largest_magnitude,
+                                             true,
+                                             3);
+  SolverControl control(eigen_max_iterations, eigen_tolerance);
+  Solver        solver(control, this->mpi_communicator, data);
+  solver.reinit(this->locally_owned_dofs);
+  solver.set_shift(std::complex<double>(eigen_shift, 0.));
+  solver.set_initial_vector(modes[0]);
+
+  std::vector<std::complex<double>> lambda(n);
+  solver.solve(this->system_matrix, mass_matrix, inverse, lambda, modes, n);
+
+  // ARPACK不保证顺序
+  std::vector<unsigned int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](const auto a, const auto b) {
+    return lambda[a].real() < lambda[b].real();
+  });
+  const auto unsorted = modes;
+  values.resize(n);
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      values[i] = lambda[order[i]].real();
+      modes[i]  = unsorted[order[i]];
+    }
+#else
+  (void)values;
+  (void)modes;
+  AssertThrow(false,
+              ExcMessage("deal.II was configured without PARPACK. Use the "
+                         "lobpcg or shift_invert eigen solver instead."));
+#endif
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::run_eigen_analysis()
+{
+  AssertThrow(!this->use_hp && this->n_load_cases() == 0 &&
+                this->linear_algebra_backend != "native",
+              ExcMessage("Eigenvalue analysis supports neither hp refinement "
+                         "nor load cases, and requires the Trilinos "
+                         "backend."));
+
+  this->startup_timer.restart();
+  this->print_system_info();
+  this->make_grid();
+  this->setup_system();
+  this->assemble_system();
+  assemble_mass_matrix();
+
+  auto run_solver = [&](const std::string &           name,
+                        std::vector<double> &          values,
+                        std::vector<LA::MPI::Vector> &modes) {
+    modes = initial_mode_guesses(n_modes);
+    Timer solver_timer(this->mpi_communicator, true);
+    if (name == "lobpcg")
+      solve_lobpcg(values, modes);
+    else if (name == "shift_invert")
+      solve_shift_invert(values, modes);
+    else
+      solve_arpack(values, modes);
+    solver_timer.stop();
+    this->pcout << "Eigen solver " << name << ": "
+                << solver_timer.wall_time() << " s" << std::endl;
+    return solver_timer.wall_time();
+  };
+
+  std::vector<LA::MPI::Vector> modes;
+  const double time = run_solver(eigen_solver, eigenvalues, modes);
+
+  for (unsigned int i = 0; i < n_modes; ++i)
+    this->pcout << "Mode " << i << ": eigenvalue = " << eigenvalues[i]
+                << ", frequency = "
+                << std::sqrt(std::max(eigenvalues[i], 0.)) / (2 * numbers::PI)
+                << std::endl;
+
+  // 基准包括分解的时间，所以先丢弃已经缓存的分解
+  if (compare_with_shift_invert && eigen_solver != "shift_invert")
+    {
+      this->direct_solver.reset();
+      shifted_solver.reset();
+      std::vector<double>          reference_values;
+      std::vector<LA::MPI::Vector> reference_modes;
+      const double                 reference_time =
+        run_solver("shift_invert", reference_values, reference_modes);
+
+      double max_difference = 0;
+      for (unsigned int i = 0; i < n_modes; ++i)
+        max_difference =
+          std::max(max_difference,
+                   std::abs(eigenvalues[i] - reference_values[i]) /
+                     std::abs(reference_values[i]));
+      this->pcout << "Speedup over shift-invert: " << reference_time / time
+                  << ", maximum relative eigenvalue difference: "
+                  << max_difference << std::endl;
+    }
+
+  // 模态满足齐次的约束
+  AffineConstraints<double> homogeneous_constraints(
+    this->locally_relevant_dofs);
+  DoFTools::make_hanging_node_constraints(this->dof_handler,
+                                          homogeneous_constraints);
+  for (const auto id : this->dirichlet_ids)
+    DoFTools::make_zero_boundary_constraints(this->dof_handler,
+                                             id,
+                                             homogeneous_constraints);
+  homogeneous_constraints.close();
+
+  mode_shapes.resize(n_modes);
+  for (unsigned int i = 0; i < n_modes; ++i)
+    {
+      homogeneous_constraints.distribute(modes[i]);
+      mode_shapes[i].reinit(this->locally_owned_dofs,
+                            this->locally_relevant_dofs,
+                            this->mpi_communicator);
+      mode_shapes[i] = modes[i];
+    }
+  this->output_results(0);
+}
+
+
+
+template <int dim>
+void
+LinearElasticity<dim>::run_explicit_dynamics()
+{
+  AssertThrow(!this->use_hp && this->n_load_cases() == 0,
+              ExcMessage("Explicit dynamics supports neither hp refinement "
+                         "nor load cases."));
+  // 外力项、边界条件和精确解都可以依赖于时间。只有表达式中出现`t`时，
+  // 才在每一步重新计算载荷向量或Dirichlet边界值。
+  this->time_dependent_functions = true;
+  const bool time_dependent_load =
+    depends_on_time(this->forcing_term_expression) ||
+    depends_on_time(this->neumann_boundary_conditions_expression);
+  const bool time_dependent_boundary =
+    depends_on_time(this->dirichlet_boundary_conditions_expression);
+  AssertThrow(!time_dependent_boundary || !this->cache_boundary_values,
+              ExcMessage("Time dependent Dirichlet boundary conditions "
+                         "cannot be cached. Set \"Cache boundary values\" "
+                         "to false."));
+
+  this->startup_timer.restart();
+  this->print_system_info();
+  this->make_grid();
+  // 显式格式不需要稀疏矩阵
+  this->allocate_system_matrix = false;
+  this->setup_system();
+  setup_explicit_dynamics();
+
+  const auto vars = dim == 1 ? "x" : dim == 2 ? "x,y" : "x,y,z";
+  initial_displacement.initialize(vars,
+                                  initial_displacement_expression,
+                                  this->constants);
+  initial_velocity.initialize(vars,
+                              initial_velocity_expression,
+                              this->constants);
+
+  VectorType displacement, velocity_vector, acceleration;
+  matrix_free.initialize_dof_vector(displacement);
+  matrix_free.initialize_dof_vector(velocity_vector);
+  matrix_free.initialize_dof_vector(acceleration);
+  VectorTools::interpolate(*this->mapping,
+                           this->dof_handler,
+                           initial_displacement,
+                           displacement);
+  VectorTools::interpolate(*this->mapping,
+                           this->dof_handler,
+                           initial_velocity,
+                           velocity_vector);
+  this->constraints.distribute(displacement);
+  // 受约束的自由度由约束决定，它们的速度为零
+  this->constraints.set_zero(velocity_vector);
+
+  auto copy_displacement = [&]() {
+    for (const auto i : this->locally_owned_dofs)
+      this->solution[i] = displacement[i];
+    this->solution.compress(VectorOperation::insert);
+    this->locally_relevant_solution = this->solution;
+  };
+
+  const unsigned int n_steps =
+    static_cast<unsigned int>(std::ceil(final_time / explicit_time_step));
+  const double time_step = final_time / n_steps;
+  this->pcout << "Explicit dynamics: " << n_steps
+              << " steps, time step = " << time_step << std::endl;
+
+  const bool has_hanging_nodes = this->triangulation.has_hanging_nodes();
+
+  Timer step_timer(this->mpi_communicator, true);
+  {
+    TimerOutput::Scope timer_section(this->timer, "explicit_dynamics");
+
+    // 半步的速度 v^{1/2} = v^0 + k/2 M^{-1}(f^0 - A u^0)
+    compute_acceleration(acceleration, displacement);
+    velocity_vector.add(0.5 * time_step, acceleration);
+
+    for (unsigned int step = 1; step <= n_steps; ++step)
+      {
+        const double time = step * time_step;
+        displacement.add(time_step, velocity_vector);
+        if (time_dependent_boundary)
+          {
+            // 约束的结构不变，MatrixFree中保存的约束仍然有效
+            this->dirichlet_boundary_condition.set_time(time);
+            this->make_constraints(this->locally_relevant_dofs);
+          }
+        if (has_hanging_nodes || time_dependent_boundary)
+          this->constraints.distribute(displacement);
+
+        // v^{n+1/2} = v^{n-1/2} + k M^{-1}(f^n - A u^n)
+        if (time_dependent_load)
+          assemble_load_vector(time);
+        compute_acceleration(acceleration, displacement);
+        velocity_vector.add(time_step, acceleration);
+
+        if (explicit_output_interval > 0 &&
+            step % explicit_output_interval == 0 && step < n_steps)
+          {
+            copy_displacement();
+            this->output_results(step);
+            this->diagnostics(step);
+          }
+      }
+  }
+  step_timer.stop();
+
+  this->pcout << "Explicit dynamics: "
+              << static_cast<double>(this->dof_handler.n_dofs()) * n_steps /
+                   step_timer.wall_time()
+              << " DoF updates/s on "
+              << Utilities::MPI::n_mpi_processes(this->mpi_communicator)
+              << " processes" << std::endl;
+
+  copy_displacement();
+  this->exact_solution.set_time(final_time);
+  this->estimate();
+  this->output_results(n_steps);
+  this->diagnostics(n_steps);
+  if (this->pcout.is_active())
+    this->current_error_table().output_table(std::cout);
+}
+
+
 template class LinearElasticity<1>;
 template class LinearElasticity<2>;
 template class LinearElasticity<3>;
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include <deal.II/base/utilities.h>
 
 #include "base_problem.h"
+#include "heat_equation.h"
 #include "linear_elasticity.h"
+#include "p_laplacian.h"
 #include "poisson.h"
 #include "stokes.h"
 
@@ -22,4 +24,8 @@ main(int argc, char **argv)
     return run<LinearElasticity<2>>(argc, argv);
   if (program_name.find("stokes") != std::string::npos)
     return run<Stokes<2>>(argc, argv);
+  if (program_name.find("heat_equation") != std::string::npos)
+    return run<HeatEquation<2>>(argc, argv);
+  if (program_name.find("p_laplacian") != std::string::npos)
+    return run<PLaplacian<2>>(argc, argv);
 }
@@ -0,0 +1,320 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+#include "nonlinear_base_problem.h"
+
+using namespace dealii;
+
+template <int dim>
+NonlinearBaseProblem<dim>::NonlinearBaseProblem(
+  const unsigned int &n_components,
+  const std::string & problem_name)
+  : BaseProblem<dim>(n_components, problem_name)
+{
+  this->enter_subsection("Newton");
+  {
+    this->add_parameter("Maximum iterations", max_newton_iterations);
+    this->add_parameter("Absolute tolerance", newton_absolute_tolerance);
+    this->add_parameter("Relative tolerance", newton_relative_tolerance);
+    this->add_parameter("Modified Newton", modified_newton);
+    this->add_parameter("Jacobian reuse", jacobian_reuse);
+    this->add_parameter("Jacobian reuse threshold", jacobian_reuse_threshold);
+    this->add_parameter("Maximum line search steps", max_line_search_steps);
+    this->add_parameter("Linear solver",
+                        newton_linear_solver,
+                        "",
+                        this->prm,
+                        Patterns::Selection("cg|gmres"));
+    this->add_parameter("Forcing term",
+                        forcing_term_strategy,
+                        "",
+                        this->prm,
+                        Patterns::Selection("eisenstat_walker|constant"));
+    this->add_parameter("Constant forcing term", constant_forcing_term);
+    this->add_parameter("Maximum forcing term", max_forcing_term);
+  }
+  this->leave_subsection();
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::assemble_residual_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  ScratchData &,
+  Vector<double> &)
+{
+  Assert(false, ExcPureFunctionCalled());
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::assemble_jacobian_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  ScratchData &,
+  FullMatrix<double> &)
+{
+  Assert(false, ExcPureFunctionCalled());
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::assemble_system_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &cell,
+  ScratchData &                                         scratch,
+  CopyData &                                            copy)
+{
+  cell->get_dof_indices(copy.local_dof_indices[0]);
+
+  scratch.reinit(cell);
+  scratch.extract_local_dof_values("solution",
+                                   this->locally_relevant_solution);
+
+  if (!this->assemble_rhs_only)
+    assemble_jacobian_one_cell(cell, scratch, copy.matrices[0]);
+
+  // 右端项是负的残差
+  assemble_residual_one_cell(cell, scratch, copy.vectors[0]);
+  copy.vectors[0] *= -1.;
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::setup_system()
+{
+  AssertThrow(this->linear_algebra_backend != "native",
+              ExcMessage("Nonlinear problems require the Trilinos backend."));
+  AssertThrow(this->estimator_type != "dwr",
+              ExcMessage("The dwr estimator needs a linear problem."));
+  BaseProblem<dim>::setup_system();
+
+  // 初始值是上一个循环的解，或者边界值的提升。它满足非齐次的约束。
+  if (solution_transfer)
+    {
+      solution_transfer->interpolate(this->solution);
+      solution_transfer.reset();
+    }
+  else
+    this->solution = 0;
+  this->constraints.distribute(this->solution);
+  this->locally_relevant_solution = this->solution;
+
+  // Newton修正量满足齐次的约束，受约束的自由度与原来的相同
+  AffineConstraints<double> homogeneous_constraints(
+    this->locally_relevant_dofs);
+  DoFTools::make_hanging_node_constraints(this->dof_handler,
+                                          homogeneous_constraints);
+  for (const auto id : this->dirichlet_ids)
+    DoFTools::make_zero_boundary_constraints(this->dof_handler,
+                                             id,
+                                             homogeneous_constraints);
+  homogeneous_constraints.close();
+  this->constraints.copy_from(homogeneous_constraints);
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::refine_grid()
+{
+  solution_transfer = std::make_unique<
+    parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector>>(
+    this->dof_handler);
+  this->triangulation.prepare_coarsening_and_refinement();
+  solution_transfer->prepare_for_coarsening_and_refinement(
+    this->locally_relevant_solution);
+  BaseProblem<dim>::refine_grid();
+}
+
+
+
+template <int dim>
+void
+NonlinearBaseProblem<dim>::solve()
+{
+  TimerOutput::Scope timer_section(this->timer, "newton");
+
+  LA::MPI::Vector update(this->locally_owned_dofs, this->mpi_communicator);
+  LA::MPI::Vector current(this->locally_owned_dofs, this->mpi_communicator);
+
+  double       residual_norm = this->system_rhs.l2_norm();
+  const double target_norm =
+    std::max(newton_absolute_tolerance,
+             newton_relative_tolerance * residual_norm);
+
+  double forcing_term = forcing_term_strategy == "constant" ?
+                          constant_forcing_term :
+                          std::min(0.5, max_forcing_term);
+
+  n_newton_iterations       = 0;
+  n_linear_iterations       = 0;
+  n_jacobians               = 1;
+  unsigned int jacobian_age = 0;
+
+  while (residual_norm > target_norm)
+    {
+      AssertThrow(n_newton_iterations < max_newton_iterations,
+                  SolverControl::NoConvergence(n_newton_iterations,
+                                               residual_norm));
+
+      // 非精确地求解 J d = -R，即 ||J d + R|| <= eta ||R||
+      {
+        TimerOutput::Scope timer_section(this->timer, "linear_solve");
+        if (!this->amg)
+          {
+            TimerOutput::Scope timer_section(this->timer, "setup_amg");
+            this->amg = std::make_unique<LA::MPI::PreconditionAMG>();
+            this->amg->initialize(this->system_matrix,
+                                  this->amg_data(this->dof_handler));
+          }
+
+        SolverControl control(this->solver_control.max_steps(),
+                              forcing_term * residual_norm);
+        update = 0;
+        if (newton_linear_solver == "cg")
+          {
+            SolverCG<LA::MPI::Vector> solver(control);
+            solver.solve(this->system_matrix,
+                         update,
+                         this->system_rhs,
+                         *this->amg);
+          }
+        else
+          {
+            SolverGMRES<LA::MPI::Vector> solver(control);
+            solver.solve(this->system_matrix,
+                         update,
+                         this->system_rhs,
+                         *this->amg);
+          }
+        n_linear_iterations += control.last_step();
+      }
+      this->constraints.distribute(update);
+
+      // 回溯线搜索，要求残差充分下降
+      current                    = this->solution;
+      double step                = 1;
+      double new_residual        = 0;
+      bool   sufficient_decrease = false;
+      for (unsigned int i = 0; i < max_line_search_steps; ++i)
+        {
+          if (i > 0)
+            step /= 2;
+          this->solution = current;
+          this->solution.add(step, update);
+          this->locally_relevant_solution = this->solution;
+          this->assemble_rhs();
+          new_residual = this->system_rhs.l2_norm();
+          if (new_residual <= (1 - 1e-4 * step) * residual_norm)
+            {
+              sufficient_decrease = true;
+              break;
+            }
+        }
+
+      if (!sufficient_decrease)
+        {
+          this->solution                  = current;
+          this->locally_relevant_solution = this->solution;
+
+          // 旧的雅可比矩阵给出的方向可能不是下降方向，用新的雅可比矩阵重试
+          AssertThrow(jacobian_age > 0,
+                      ExcMessage("The line search did not reduce the "
+                                 "residual " +
+                                 std::to_string(residual_norm) + " after " +
+                                 std::to_string(max_line_search_steps) +
+                                 " steps; the smallest step gave " +
+                                 std::to_string(new_residual) + "."));
+          this->pcout << "Newton iteration " << n_newton_iterations + 1
+                      << ": line search failed with an old Jacobian, "
+                      << "assembling a new one" << std::endl;
+          this->system_matrix = 0;
+          this->system_rhs    = 0;
+          this->assemble_system();
+          jacobian_age = 0;
+          ++n_jacobians;
+          continue;
+        }
+      ++n_newton_iterations;
+
+      this->pcout << "Newton iteration " << n_newton_iterations
+                  << ": residual = " << new_residual << ", step = " << step
+                  << std::endl;
+
+      // Eisenstat-Walker的第二种选择，带防止过早变小和过度求解的保护
+      if (forcing_term_strategy == "eisenstat_walker")
+        {
+          const double gamma     = 0.9;
+          const double safeguard = gamma * forcing_term * forcing_term;
+          double       eta =
+            gamma * Utilities::fixed_power<2>(new_residual / residual_norm);
+          if (safeguard > 0.1)
+            eta = std::max(eta, safeguard);
+          eta          = std::max(eta, 0.5 * target_norm / new_residual);
+          forcing_term = std::min(max_forcing_term, eta);
+        }
+
+      const double contraction = new_residual / residual_norm;
+      residual_norm            = new_residual;
+      if (residual_norm <= target_norm)
+        break;
+
+      // 修正Newton法中，残差下降得足够快时保留雅可比矩阵和AMG
+      if (modified_newton && jacobian_age + 1 < jacobian_reuse &&
+          contraction <= jacobian_reuse_threshold)
+        ++jacobian_age;
+      else
+        {
+          this->system_matrix = 0;
+          this->system_rhs    = 0;
+          this->assemble_system();
+          jacobian_age = 0;
+          ++n_jacobians;
+        }
+    }
+
+  this->pcout << "Newton: " << n_newton_iterations << " iterations, "
+              << n_jacobians << " Jacobians, " << n_linear_iterations
+              << " linear iterations" << std::endl;
+
+  auto &table = this->current_error_table();
+  table.add_extra_column(
+    "newton_its",
+    [n = n_newton_iterations]() { return n; },
+    false);
+  table.add_extra_column(
+    "jacobians", [n = n_jacobians]() { return n; }, false);
+  table.add_extra_column(
+    "linear_its",
+    [n = n_linear_iterations]() { return n; },
+    false);
+}
+
+
+template class NonlinearBaseProblem<1>;
+template class NonlinearBaseProblem<2>;
+template class NonlinearBaseProblem<3>;
@@ -0,0 +1,151 @@
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2020 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Authors: Wolfgang Bangerth, 1999,
+ *          Guido Kanschat, 2011
+ *          Luca Heltai, 2021
+ */
+#include "p_laplacian.h"
+
+using namespace dealii;
+
+template <int dim>
+PLaplacian<dim>::PLaplacian()
+  : NonlinearBaseProblem<dim>(1, "PLaplacian<" + std::to_string(dim) + ">")
+{
+  this->add_parameter("Exponent", exponent);
+  this->add_parameter("Regularization", regularization);
+
+  // Output the scalar result.
+  this->add_data_vector.connect([&](auto &data_out) {
+    data_out.add_data_vector(this->locally_relevant_solution, "solution");
+  });
+}
+
+
+
+template <int dim>
+void
+PLaplacian<dim>::assemble_jacobian_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &,
+  ScratchData &       scratch,
+  FullMatrix<double> &cell_jacobian)
+{
+  const auto &fe_values = scratch.get_current_fe_values();
+  const auto &gradients =
+    scratch.get_gradients("solution", FEValuesExtractors::Scalar(0));
+  const double epsilon2 = regularization * regularization;
+
+  cell_jacobian = 0;
+  for (const unsigned int q_index : fe_values.quadrature_point_indices())
+    {
+      // a = (eps^2+|g|^2)^{(p-2)/2}, da/dg = (p-2)(eps^2+|g|^2)^{(p-4)/2} g
+      const auto & g       = gradients[q_index];
+      const double norm2   = epsilon2 + g * g;
+      const double a       = std::pow(norm2, (exponent - 2) / 2);
+      const double a_prime = (exponent - 2) * a / norm2;
+      for (const unsigned int i : fe_values.dof_indices())
+        {
+          const auto & grad_i = fe_values.shape_grad(i, q_index);
+          const double g_i    = g * grad_i;
+          for (const unsigned int j : fe_values.dof_indices())
+            {
+              const auto &grad_j = fe_values.shape_grad(j, q_index);
+              cell_jacobian(i, j) +=
+                (a * grad_i * grad_j + a_prime * g_i * (g * grad_j)) *
+                fe_values.JxW(q_index);
+            }
+        }
+    }
+}
+
+
+
+template <int dim>
+void
+PLaplacian<dim>::assemble_residual_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &cell,
+  ScratchData &                                         scratch,
+  Vector<double> &                                      cell_residual)
+{
+  const auto &fe_values = scratch.get_current_fe_values();
+  const auto &gradients =
+    scratch.get_gradients("solution", FEValuesExtractors::Scalar(0));
+  const double epsilon2 = regularization * regularization;
+
+  cell_residual = 0;
+  for (const unsigned int q_index : fe_values.quadrature_point_indices())
+    {
+      const auto & g = gradients[q_index];
+      const double a = std::pow(epsilon2 + g * g, (exponent - 2) / 2);
+      const double f =
+        this->forcing_term.value(fe_values.quadrature_point(q_index));
+      for (const unsigned int i : fe_values.dof_indices())
+        cell_residual(i) += (a * g * fe_values.shape_grad(i, q_index) -
+                             f * fe_values.shape_value(i, q_index)) *
+                            fe_values.JxW(q_index);
+    }
+
+  // 面上的FEValues会替换当前的FEValues，所以放在最后
+  if (cell->at_boundary())
+    for (unsigned int f = 0; f < GeometryInfo<dim>::faces_per_cell; ++f)
+      if (this->neumann_ids.find(cell->face(f)->boundary_id()) !=
+          this->neumann_ids.end())
+        {
+          auto &fe_face_values = scratch.reinit(cell, f);
+          for (const unsigned int q_index :
+               fe_face_values.quadrature_point_indices())
+            for (const unsigned int i : fe_face_values.dof_indices())
+              cell_residual(i) -= fe_face_values.shape_value(i, q_index) *
+                                  this->neumann_boundary_condition.value(
+                                    fe_face_values.quadrature_point(q_index)) *
+                                  fe_face_values.JxW(q_index);
+        }
+}
+
+
+
+template <int dim>
+void
+PLaplacian<dim>::compute_strong_residual(
+  const FEValues<dim> &        fe_values,
+  const Vector<double> &       local_dof_values,
+  std::vector<Vector<double>> &residuals) const
+{
+  const double epsilon2 = regularization * regularization;
+  for (const auto q : fe_values.quadrature_point_indices())
+    {
+      Tensor<1, dim> g;
+      Tensor<2, dim> hessian;
+      for (const unsigned int i : fe_values.dof_indices())
+        {
+          g += local_dof_values(i) * fe_values.shape_grad(i, q);
+          hessian += local_dof_values(i) * fe_values.shape_hessian(i, q);
+        }
+
+      // div(a g) = a tr(H) + g . grad a，其中 grad a = a' H g
+      const double norm2   = epsilon2 + g * g;
+      const double a       = std::pow(norm2, (exponent - 2) / 2);
+      const double a_prime = (exponent - 2) * a / norm2;
+      residuals[q](0) =
+        this->forcing_term.value(fe_values.quadrature_point(q)) +
+        a * trace(hessian) + a_prime * (g * (hessian * g));
+    }
+}
+
+
+template class PLaplacian<1>;
+template class PLaplacian<2>;
+template class PLaplacian<3>;
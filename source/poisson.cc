@@ -55,23 +55,42 @@ Poisson<dim>::assemble_system_one_cell(
 
   const auto &fe_values = scratch.reinit(cell);
   cell_matrix           = 0;
+
+  if (!this->assemble_rhs_only)
+    for (const unsigned int q_index : fe_values.quadrature_point_indices())
+      {
+        const double coefficient_value =
+          coefficient.value(fe_values.quadrature_point(q_index)); // a(x_q)
+        for (const unsigned int i : fe_values.dof_indices())
+          for (const unsigned int j : fe_values.dof_indices())
+            cell_matrix(i, j) +=
+              (coefficient_value *                // a(x_q)
+               fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
+               fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
+               fe_values.JxW(q_index));           // dx
+      }
+
+  assemble_rhs_one_cell(cell, scratch, cell_rhs);
+}
+
+
+
+template <int dim>
+void
+Poisson<dim>::assemble_rhs_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &cell,
+  ScratchData &                                         scratch,
+  Vector<double> &                                      cell_rhs)
+{
+  const auto &fe_values = scratch.get_current_fe_values();
   cell_rhs              = 0;
 
   for (const unsigned int q_index : fe_values.quadrature_point_indices())
-    {
-      for (const unsigned int i : fe_values.dof_indices())
-        for (const unsigned int j : fe_values.dof_indices())
-          cell_matrix(i, j) +=
-            (coefficient.value(fe_values.quadrature_point(q_index)) * // a(x_q)
-             fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
-             fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
-             fe_values.JxW(q_index));           // dx
-      for (const unsigned int i : fe_values.dof_indices())
-        cell_rhs(i) += (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                        this->forcing_term.value(
-                          fe_values.quadrature_point(q_index)) * // f(x_q)
-                        fe_values.JxW(q_index));                 // dx
-    }
+    for (const unsigned int i : fe_values.dof_indices())
+      cell_rhs(i) += (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                      this->forcing_term.value(
+                        fe_values.quadrature_point(q_index)) * // f(x_q)
+                      fe_values.JxW(q_index));                 // dx
 
   if (cell->at_boundary())
     //  for(const auto face: cell->face_indices())
@@ -90,6 +109,236 @@ Poisson<dim>::assemble_system_one_cell(
         }
 }
 
+
+
+template <int dim>
+void
+Poisson<dim>::assemble_boundary_face_one_cell(
+  const typename DoFHandler<dim>::active_cell_iterator &cell,
+  const unsigned int                                    face_no,
+  ScratchData &                                         scratch,
+  CopyData &                                            copy)
+{
+  auto &cell_matrix = copy.matrices[0];
+  auto &cell_rhs    = copy.vectors[0];
+
+  const auto &fe_face_values = scratch.reinit(cell, face_no);
+
+  // h is the cell size normal to the face
+  const unsigned int degree = cell->get_fe().degree;
+  const double       h = cell->measure() / cell->face(face_no)->measure();
+  const double       penalty = this->dg_penalty * degree * (degree + 1) / h;
+
+  for (const unsigned int q_index : fe_face_values.quadrature_point_indices())
+    {
+      const auto &x_q    = fe_face_values.quadrature_point(q_index);
+      const auto &normal = fe_face_values.normal_vector(q_index);
+      const double a     = coefficient.value(x_q);
+      const double g     = this->dirichlet_boundary_condition.value(x_q);
+      const double JxW   = fe_face_values.JxW(q_index);
+
+      for (const unsigned int i : fe_face_values.dof_indices())
+        {
+          const double phi_i   = fe_face_values.shape_value(i, q_index);
+          const double dphi_in = fe_face_values.shape_grad(i, q_index) * normal;
+
+          if (!this->assemble_rhs_only)
+            for (const unsigned int j : fe_face_values.dof_indices())
+              {
+                const double phi_j = fe_face_values.shape_value(j, q_index);
+                const double dphi_jn =
+                  fe_face_values.shape_grad(j, q_index) * normal;
+                cell_matrix(i, j) += (-a * dphi_jn * phi_i   // consistency
+                                      - a * dphi_in * phi_j  // symmetry
+                                      + a * penalty * phi_i * phi_j) *
+                                     JxW;
+              }
+
+          cell_rhs(i) += (-a * dphi_in + a * penalty * phi_i) * g * JxW;
+        }
+    }
+}
+
+
+
+template <int dim>
+void
+Poisson<dim>::assemble_interior_face(
+  const typename DoFHandler<dim>::active_cell_iterator &cell,
+  const unsigned int                                    face_no,
+  const unsigned int                                    subface_no,
+  const typename DoFHandler<dim>::active_cell_iterator &neighbor,
+  const unsigned int                                    neighbor_face_no,
+  const unsigned int                                    neighbor_subface_no,
+  ScratchData &                                         scratch,
+  typename BaseProblem<dim>::FaceCopyData &             copy)
+{
+  const auto &fe_interface_values = scratch.reinit(cell,
+                                                   face_no,
+                                                   subface_no,
+                                                   neighbor,
+                                                   neighbor_face_no,
+                                                   neighbor_subface_no);
+
+  copy.joint_dof_indices = fe_interface_values.get_interface_dof_indices();
+  const unsigned int n_dofs =
+    fe_interface_values.n_current_interface_dofs();
+  copy.matrix.reinit(n_dofs, n_dofs);
+
+  // Average of 1/h on both sides
+  const unsigned int degree = cell->get_fe().degree;
+  const double       penalty =
+    this->dg_penalty * degree * (degree + 1) * 0.5 *
+    (cell->face(face_no)->measure() / cell->measure() +
+     neighbor->face(neighbor_face_no)->measure() / neighbor->measure());
+
+  const auto &fe_face_values = fe_interface_values.get_fe_face_values(0);
+  for (const unsigned int q_index :
+       fe_interface_values.quadrature_point_indices())
+    {
+      const auto &normal = fe_face_values.normal_vector(q_index);
+      const double a =
+        coefficient.value(fe_face_values.quadrature_point(q_index));
+      const double JxW = fe_interface_values.JxW(q_index);
+
+      for (unsigned int i = 0; i < n_dofs; ++i)
+        {
+          const double jump_i =
+            fe_interface_values.jump_in_shape_values(i, q_index);
+          const double average_in =
+            fe_interface_values.average_of_shape_gradients(i, q_index) *
+            normal;
+          for (unsigned int j = 0; j < n_dofs; ++j)
+            {
+              const double jump_j =
+                fe_interface_values.jump_in_shape_values(j, q_index);
+              const double average_jn =
+                fe_interface_values.average_of_shape_gradients(j, q_index) *
+                normal;
+              copy.matrix(i, j) += (-a * average_jn * jump_i   // consistency
+                                    - a * average_in * jump_j  // symmetry
+                                    + a * penalty * jump_i * jump_j) *
+                                   JxW;
+            }
+        }
+    }
+}
+
+
+
+template <int dim>
+void
+Poisson<dim>::assemble_system_batch(
+  const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+  ScratchData &                                                      scratch,
+  std::vector<CopyData> &                                            copies)
+{
+  using VA                  = VectorizedArray<double>;
+  const unsigned int n_dofs = cells.front()->get_fe().n_dofs_per_cell();
+
+  // 与线程局部的ScratchData一起保存，不会在每一批中重新分配。
+  // AlignedVector保证VectorizedArray按SIMD寄存器的宽度对齐。
+  auto &storage = scratch.get_general_data_storage();
+  auto &weights =
+    storage.template get_or_add_object_with_name<AlignedVector<VA>>(
+      "batch_weights");
+  auto &gradients = storage.template get_or_add_object_with_name<
+    AlignedVector<Tensor<1, dim, VA>>>("batch_gradients");
+
+  // 第一遍：逐个单元计算FEValues，把 a(x_q) JxW 和形函数梯度放到各自的通道中
+  unsigned int n_q_points = 0;
+  for (unsigned int lane = 0; lane < cells.size(); ++lane)
+    {
+      const auto &fe_values = scratch.reinit(cells[lane]);
+      cells[lane]->get_dof_indices(copies[lane].local_dof_indices[0]);
+
+      if (!this->assemble_rhs_only)
+        {
+          if (lane == 0)
+            {
+              n_q_points = fe_values.n_quadrature_points;
+              weights.resize(n_q_points);
+              gradients.resize(n_dofs * n_q_points);
+              for (auto &w : weights)
+                w = 0.;
+            }
+
+          for (const unsigned int q : fe_values.quadrature_point_indices())
+            {
+              weights[q][lane] =
+                coefficient.value(fe_values.quadrature_point(q)) *
+                fe_values.JxW(q);
+              for (const unsigned int i : fe_values.dof_indices())
+                {
+                  const auto &grad = fe_values.shape_grad(i, q);
+                  for (unsigned int d = 0; d < dim; ++d)
+                    gradients[i * n_q_points + q][d][lane] = grad[d];
+                }
+            }
+        }
+
+      assemble_rhs_one_cell(cells[lane], scratch, copies[lane].vectors[0]);
+    }
+
+  if (this->assemble_rhs_only)
+    return;
+
+  // 第二遍：所有通道同时计算对称的局部矩阵。空通道的权重为零。
+  for (unsigned int i = 0; i < n_dofs; ++i)
+    for (unsigned int j = i; j < n_dofs; ++j)
+      {
+        const Tensor<1, dim, VA> *grad_i = &gradients[i * n_q_points];
+        const Tensor<1, dim, VA> *grad_j = &gradients[j * n_q_points];
+
+        VA sum = 0.;
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          sum += weights[q] * (grad_i[q] * grad_j[q]);
+
+        for (unsigned int lane = 0; lane < cells.size(); ++lane)
+          {
+            copies[lane].matrices[0](i, j) = sum[lane];
+            copies[lane].matrices[0](j, i) = sum[lane];
+          }
+      }
+}
+
+
+
+template <int dim>
+void
+Poisson<dim>::compute_strong_residual(
+  const FEValues<dim> &        fe_values,
+  const Vector<double> &       local_dof_values,
+  std::vector<Vector<double>> &residuals) const
+{
+  for (const auto q : fe_values.quadrature_point_indices())
+    {
+      Tensor<1, dim> gradient;
+      double         laplacian = 0;
+      for (const unsigned int i : fe_values.dof_indices())
+        {
+          gradient += local_dof_values(i) * fe_values.shape_grad(i, q);
+          laplacian +=
+            local_dof_values(i) * trace(fe_values.shape_hessian(i, q));
+        }
+
+      const auto &x_q = fe_values.quadrature_point(q);
+      residuals[q](0) = this->forcing_term.value(x_q) +
+                        coefficient.value(x_q) * laplacian +
+                        coefficient.gradient(x_q) * gradient;
+    }
+}
+
+
+
+template <int dim>
+const Function<dim> *
+Poisson<dim>::estimator_coefficient() const
+{
+  return &coefficient;
+}
+
+
 template class Poisson<1>;
 template class Poisson<2>;
 template class Poisson<3>;
\ No newline at end of file
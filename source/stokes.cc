@@ -76,43 +76,75 @@ Stokes<dim>::assemble_system_one_cell(
   cell->get_dof_indices(copy.local_dof_indices[0]);
 
   const auto &fe_values = scratch.reinit(cell);
+  const auto &fe        = cell->get_fe();
   cell_matrix           = 0;
   cell_rhs              = 0;
 
+  // 每个积分点上的形函数数据只计算一次，缓冲区保存在ScratchData中
+  auto &storage = scratch.get_general_data_storage();
+  auto &eps = storage.template get_or_add_object_with_name<
+    std::vector<SymmetricTensor<2, dim>>>("stokes_symgrad");
+  auto &div =
+    storage.template get_or_add_object_with_name<std::vector<double>>(
+      "stokes_div");
+  auto &pressure_values =
+    storage.template get_or_add_object_with_name<std::vector<double>>(
+      "stokes_pressure");
+  auto &is_velocity =
+    storage.template get_or_add_object_with_name<std::vector<bool>>(
+      "stokes_is_velocity");
+  auto &forcing_values =
+    storage.template get_or_add_object_with_name<Vector<double>>(
+      "stokes_forcing", dim + 1);
+
+  const unsigned int n_dofs = fe.n_dofs_per_cell();
+  eps.resize(n_dofs);
+  div.resize(n_dofs);
+  pressure_values.resize(n_dofs);
+  is_velocity.resize(n_dofs);
+  for (const unsigned int i : fe_values.dof_indices())
+    is_velocity[i] = fe.system_to_component_index(i).first < dim;
+
   for (const unsigned int q_index : fe_values.quadrature_point_indices())
     {
+      const double JxW = fe_values.JxW(q_index);
+
+      // 速度形函数的压力分量为零，反之亦然
+      for (const unsigned int k : fe_values.dof_indices())
+        if (is_velocity[k])
+          {
+            eps[k] = fe_values[velocity].symmetric_gradient(k, q_index);
+            div[k] = fe_values[velocity].divergence(k, q_index);
+          }
+        else
+          pressure_values[k] = fe_values[pressure].value(k, q_index);
+
+      // 只组装下三角部分：速度-速度和压力-速度块，压力-压力块为零
+      for (const unsigned int i : fe_values.dof_indices())
+        for (unsigned int j = 0; j <= i; ++j)
+          {
+            if (is_velocity[i] && is_velocity[j])
+              cell_matrix(i, j) += scalar_product(eps[i], eps[j]) * JxW;
+            else if (is_velocity[i])
+              cell_matrix(i, j) -= pressure_values[j] * div[i] * JxW;
+            else if (is_velocity[j])
+              cell_matrix(i, j) -= pressure_values[i] * div[j] * JxW;
+          }
+
+      this->forcing_term.vector_value(fe_values.quadrature_point(q_index),
+                                      forcing_values); // f(x_q)
       for (const unsigned int i : fe_values.dof_indices())
         {
-          const auto eps_v = fe_values[velocity].symmetric_gradient(
-            i, q_index); // SymmetricTensor<2,dim>
-          const auto div_v =
-            fe_values[velocity].divergence(i, q_index);         // double
-          const auto q = fe_values[pressure].value(i, q_index); // double
-
-          for (const unsigned int j : fe_values.dof_indices())
-            {
-              const auto eps_u = fe_values[velocity].symmetric_gradient(
-                j, q_index); // SymmetricTensor<2,dim>
-              const auto div_u =
-                fe_values[velocity].divergence(j, q_index);         // double
-              const auto p = fe_values[pressure].value(j, q_index); // double
-
-              cell_matrix(i, j) +=
-                (scalar_product(eps_v, eps_u) - p * div_v - q * div_u) *
-                fe_values.JxW(q_index); // dx
-            }
-          for (const unsigned int i : fe_values.dof_indices())
-            {
-              const auto comp_i = this->fe->system_to_component_index(i).first;
-              cell_rhs(i) +=
-                (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                 this->forcing_term.value(fe_values.quadrature_point(q_index),
-                                          comp_i) * // f(x_q)
-                 fe_values.JxW(q_index));           // dx
-            }
+          const auto comp_i = fe.system_to_component_index(i).first;
+          cell_rhs(i) += fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                         forcing_values[comp_i] * JxW;       // f(x_q) dx
         }
     }
 
+  for (const unsigned int i : fe_values.dof_indices())
+    for (unsigned int j = i + 1; j < n_dofs; ++j)
+      cell_matrix(i, j) = cell_matrix(j, i);
+
   if (cell->at_boundary())
     //  for(const auto face: cell->face_indices())
     for (unsigned int f = 0; f < GeometryInfo<dim>::faces_per_cell; ++f)
@@ -136,6 +168,17 @@ Stokes<dim>::assemble_system_one_cell(
 }
 
 
+template <int dim>
+Table<2, DoFTools::Coupling>
+Stokes<dim>::coupling_table() const
+{
+  auto coupling = BaseBlockProblem<dim>::coupling_table();
+  coupling(dim, dim) = DoFTools::none;
+  return coupling;
+}
+
+
+
 template <int dim>
 void
 Stokes<dim>::solve()
@@ -162,7 +205,11 @@ void
 Stokes<dim>::estimate()
 {
   TimerOutput::Scope timer_section(this->timer, "estimate");
-  if (this->estimator_type == "kelly")
+  if (this->estimator_type == "exact")
+    {
+      this->error_per_cell = 0;
+    }
+  else if (this->estimator_type == "kelly")
     {
       std::map<types::boundary_id, const Function<dim> *> neumann;
       for (const auto id : this->neumann_ids)
@@ -181,14 +228,8 @@ Stokes<dim>::estimate()
     {
       AssertThrow(false, ExcNotImplemented());
     }
-  auto global_estimator = this->error_per_cell.l2_norm();
-  this->error_table.add_extra_column("estimator", [global_estimator]() {
-    return global_estimator;
-  });
-  this->error_table.error_from_exact(*this->mapping,
-                                     this->dof_handler,
-                                     this->locally_relevant_block_solution,
-                                     this->exact_solution);
+  this->evaluate_errors(this->locally_relevant_block_solution,
+                        this->estimator_type == "exact");
 }
 
 
@@ -0,0 +1,66 @@
+#include "heat_equation_tester.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace dealii;
+
+using HeatEquation2DTester =
+  HeatEquationTester<std::integral_constant<int, 2>>;
+
+
+// Test only two dimensional code
+TEST_F(HeatEquation2DTester, TestCrankNicolsonQuadraticInTime)
+{
+  std::stringstream str;
+
+  // u = t^2 + x^2 lies in the finite element space at all times, and the
+  // Crank-Nicolson scheme integrates u' = 2t exactly
+  str << "subsection HeatEquation<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = t^2 + x^2"
+      << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = t^2 + x^2"
+      << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = 2*t - 2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Initial condition expression            = x^2" << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "  subsection Time stepping" << std::endl
+      << "    set Final time        = 0.5" << std::endl
+      << "    set Initial time step = 0.1" << std::endl
+      << "    set Output interval   = 0" << std::endl
+      << "    set Theta             = 0.5" << std::endl
+      << "  end" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  run();
+
+  auto tmp = solution;
+  VectorTools::interpolate(*mapping, dof_handler, exact_solution, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-8);
+}
+
+
+
+TEST_F(HeatEquation2DTester, TestCachedBoundaryValuesAreRejected)
+{
+  std::stringstream str;
+
+  str << "subsection HeatEquation<2>" << std::endl
+      << "  set Cache boundary values = true" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  ASSERT_ANY_THROW(run());
+}
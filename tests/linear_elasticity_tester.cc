@@ -0,0 +1,188 @@
+#include "linear_elasticity_tester.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace dealii;
+
+using LinearElasticity1DTester =
+  LinearElasticityTester<std::integral_constant<int, 1>>;
+
+
+TEST_F(LinearElasticity1DTester, TestExplicitStandingWave)
+{
+  std::stringstream str;
+
+  // In one dimension the wave speed is sqrt((mu + lambda) / rho) = sqrt(2).
+  // The standing wave is superposed with x*t^3, so that both the forcing
+  // term f = 6*x*t and the Dirichlet value u(1, t) = t^3 change in time.
+  const std::string expression = "sin(pi*x)*cos(sqrt(2)*pi*t) + x*t^3";
+  str << "subsection LinearElasticity<1>" << std::endl
+      << "  set Cache boundary values                   = false" << std::endl
+      << "  set Dirichlet boundary condition expression = " << expression
+      << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = " << expression
+      << std::endl
+      << "  set Finite element space = FESystem[FE_Q(2)^1]" << std::endl
+      << "  set Forcing term expression                 = 6*x*t" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Linear elasticity lambda                = 1" << std::endl
+      << "  set Linear elasticity mu                    = 1" << std::endl
+      << "  set Number of global refinements            = 5" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "  set Problem constants = pi:3.141592653589793" << std::endl
+      << "  subsection Explicit dynamics" << std::endl
+      << "    set Enable                          = true" << std::endl
+      << "    set Density                         = 1" << std::endl
+      << "    set Final time                      = 0.5" << std::endl
+      << "    set Initial displacement expression = sin(pi*x)" << std::endl
+      << "    set Initial velocity expression     = 0" << std::endl
+      << "    set Output interval                 = 0" << std::endl
+      << "  end" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  run();
+
+  ASSERT_LT(latest_errors.at("u_L2_norm"), 1e-3);
+
+  auto tmp = solution;
+  VectorTools::interpolate(*mapping, dof_handler, exact_solution, tmp);
+  tmp -= solution;
+  ASSERT_LT(tmp.linfty_norm(), 1e-3);
+}
+
+
+
+namespace
+{
+  // A bar on [0, 1] fixed at both ends has the eigenvalues
+  // (mu + lambda) (k pi)^2 / rho and the modes sin(k pi x). The parameters
+  // below give (mu + lambda) / rho = 1.
+  std::string
+  fixed_bar_parameters(const std::string &eigen_solver)
+  {
+    std::stringstream str;
+    str << "subsection LinearElasticity<1>" << std::endl
+        << "  set Dirichlet boundary condition expression = 0" << std::endl
+        << "  set Dirichlet boundary ids                  = 0" << std::endl
+        << "  set Finite element space = FESystem[FE_Q(2)^1]" << std::endl
+        << "  set Grid generator arguments                = 0: 1: false"
+        << std::endl
+        << "  set Grid generator function                 = hyper_cube"
+        << std::endl
+        << "  set Linear elasticity lambda                = 1" << std::endl
+        << "  set Linear elasticity mu                    = 2" << std::endl
+        << "  set Number of global refinements            = 5" << std::endl
+        << "  set Output format                           = none" << std::endl
+        << "  subsection Explicit dynamics" << std::endl
+        << "    set Density = 3" << std::endl
+        << "  end" << std::endl
+        << "  subsection Eigenvalue analysis" << std::endl
+        << "    set Eigen solver    = " << eigen_solver << std::endl
+        << "    set Enable          = true" << std::endl
+        << "    set Number of modes = 3" << std::endl
+        << "  end" << std::endl
+        << "end" << std::endl;
+    return str.str();
+  }
+} // namespace
+
+
+class FixedBar1DTester : public LinearElasticity1DTester
+{
+protected:
+  void
+  check_modes()
+  {
+    ASSERT_EQ(eigenvalues.size(), 3u);
+    ASSERT_EQ(mode_shapes.size(), 3u);
+    for (unsigned int i = 0; i < 3; ++i)
+      {
+        const double k = i + 1;
+        ASSERT_NEAR(eigenvalues[i] / (k * k * numbers::PI * numbers::PI),
+                    1.,
+                    1e-4);
+
+        // The mode is sin(k pi x) up to its sign and scaling
+        auto expected = solution;
+        VectorTools::interpolate(*mapping,
+                                 dof_handler,
+                                 ScalarFunctionFromFunctionObject<1>(
+                                   [k](const Point<1> &p) {
+                                     return std::sin(k * numbers::PI * p[0]);
+                                   }),
+                                 expected);
+        auto mode = solution;
+        mode      = mode_shapes[i];
+        ASSERT_NEAR(std::abs(mode * expected) /
+                      (mode.l2_norm() * expected.l2_norm()),
+                    1.,
+                    1e-6);
+      }
+  }
+};
+
+
+TEST_F(FixedBar1DTester, TestModesWithLOBPCG)
+{
+  parse_string(fixed_bar_parameters("lobpcg"));
+  run();
+  check_modes();
+}
+
+
+TEST_F(FixedBar1DTester, TestModesWithShiftInvert)
+{
+  parse_string(fixed_bar_parameters("shift_invert"));
+  run();
+  check_modes();
+}
+
+
+
+using LinearElasticity2DTester =
+  LinearElasticityTester<std::integral_constant<int, 2>>;
+
+
+TEST_F(LinearElasticity2DTester, TestAMGIterationsWithRigidBodyModes)
+{
+  std::stringstream str;
+
+  str << "subsection LinearElasticity<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = 0; 0" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space = FESystem[FE_Q(1)^2]" << std::endl
+      << "  set Forcing term expression                 = 1; 1" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Linear elasticity lambda                = 1" << std::endl
+      << "  set Linear elasticity mu                    = 1" << std::endl
+      << "  set Number of global refinements            = 5" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+  const unsigned int coarse_iterations = solver_control.last_step();
+
+  triangulation.refine_global(1);
+  setup_system();
+  assemble_system();
+  solve();
+  const unsigned int fine_iterations = solver_control.last_step();
+
+  // With the rigid body modes as near null space the AMG preconditioner is
+  // close to mesh independent
+  ASSERT_GT(coarse_iterations, 0u);
+  ASSERT_LE(fine_iterations, coarse_iterations + 5);
+}
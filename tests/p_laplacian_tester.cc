@@ -0,0 +1,135 @@
+#include "p_laplacian_tester.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace dealii;
+
+using PLaplacian2DTester = PLaplacianTester<std::integral_constant<int, 2>>;
+
+
+TEST_F(PLaplacian2DTester, TestLinearCaseConvergesInOneStep)
+{
+  std::stringstream str;
+
+  // For p = 2 the problem is the Poisson problem, whose discrete solution is
+  // x^2 + y^2 in FE_Q(2). With an exact inner solve Newton needs one step.
+  str << "subsection PLaplacian<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2 + y^2"
+      << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = x^2 + y^2"
+      << std::endl
+      << "  set Exponent                                = 2" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -4" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Number of refinement cycles             = 1" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "  subsection Newton" << std::endl
+      << "    set Constant forcing term = 1e-12" << std::endl
+      << "    set Forcing term          = constant" << std::endl
+      << "  end" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  run();
+
+  ASSERT_EQ(n_newton_iterations, 1u);
+  ASSERT_EQ(n_jacobians, 1u);
+  ASSERT_NEAR(latest_errors.at("u_L2_norm"), 0, 1e-8);
+}
+
+
+
+TEST_F(PLaplacian2DTester, TestManufacturedSolution)
+{
+  std::stringstream str;
+
+  // u = x^2 gives the flux (eps^2 + 4x^2)^{1/2} 2x for p = 3, and
+  // f = -(2 sqrt(eps^2 + 4x^2) + 8x^2 / sqrt(eps^2 + 4x^2)).
+  str << "subsection PLaplacian<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Exponent                                = 3" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = "
+      << "-(2*sqrt(eps^2 + 4*x^2) + 8*x^2/sqrt(eps^2 + 4*x^2))" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "  set Number of refinement cycles             = 1" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "  set Problem constants                       = eps:0.1"
+      << std::endl
+      << "  set Regularization                          = 0.1" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  run();
+
+  ASSERT_LT(latest_errors.at("u_L2_norm"), 1e-3);
+
+  // Full Newton assembles one Jacobian per step and converges quickly
+  ASSERT_GE(n_newton_iterations, 2u);
+  ASSERT_LE(n_newton_iterations, 10u);
+  ASSERT_EQ(n_jacobians, n_newton_iterations);
+}
+
+
+
+TEST_F(PLaplacian2DTester, TestRefinementKeepsNewtonIterate)
+{
+  std::stringstream str;
+
+  // The manufactured solution u = x^2 of TestManufacturedSolution
+  str << "subsection PLaplacian<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Exponent                                = 3" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = "
+      << "-(2*sqrt(eps^2 + 4*x^2) + 8*x^2/sqrt(eps^2 + 4*x^2))" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Problem constants                       = eps:0.1"
+      << std::endl
+      << "  set Regularization                          = 0.1" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+  const unsigned int coarse_iterations = n_newton_iterations;
+
+  for (const auto &cell : triangulation.active_cell_iterators())
+    if (cell->is_locally_owned())
+      cell->set_refine_flag();
+  refine_grid();
+  setup_system();
+
+  // The initial iterate on the refined mesh is the converged solution of the
+  // coarse mesh, not the lift of the boundary values, which is zero inside
+  auto tmp = solution;
+  VectorTools::interpolate(*mapping, dof_handler, exact_solution, tmp);
+  tmp -= solution;
+  ASSERT_LT(tmp.linfty_norm(), 1e-2);
+
+  assemble_system();
+  solve();
+  ASSERT_LE(n_newton_iterations, coarse_iterations);
+}
@@ -1,12 +1,99 @@
+#include "lobpcg.h"
 #include "poisson_tester.h"
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <new>
 #include <sstream>
 
+#include <unistd.h>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif
+
 using namespace dealii;
 
+#ifdef DEBUG
+// Count the heap allocations of each thread in the test binary. The
+// nothrow and array forms of operator new and delete forward to these by
+// default, so replacing the plain and the aligned forms covers all of them.
+namespace
+{
+  thread_local std::size_t thread_local_allocations = 0;
+
+  std::size_t
+  count_thread_local_allocations()
+  {
+    return thread_local_allocations;
+  }
+
+  void *
+  counted_allocation(std::size_t size, const std::size_t alignment)
+  {
+    ++thread_local_allocations;
+    if (size == 0)
+      size = 1;
+    while (true)
+      {
+        void *pointer = nullptr;
+        if (alignment == 0)
+          pointer = std::malloc(size);
+        else
+          pointer =
+            std::aligned_alloc(alignment,
+                               (size + alignment - 1) / alignment * alignment);
+        if (pointer != nullptr)
+          return pointer;
+
+        const std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+          throw std::bad_alloc();
+        handler();
+      }
+  }
+} // namespace
+
+void *
+operator new(std::size_t size)
+{
+  return counted_allocation(size, 0);
+}
+
+void *
+operator new(std::size_t size, std::align_val_t alignment)
+{
+  return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void
+operator delete(void *pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void
+operator delete(void *pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void
+operator delete(void *pointer, std::align_val_t) noexcept
+{
+  std::free(pointer);
+}
+
+void
+operator delete(void *pointer, std::size_t, std::align_val_t) noexcept
+{
+  std::free(pointer);
+}
+#endif
+
 using PoissonTestTypes = ::testing::Types<std::integral_constant<int, 2>,
                                           std::integral_constant<int, 3>>;
 
@@ -98,6 +185,923 @@ TEST_F(Poisson2DTester, TestQuadratic)
 }
 
 
+// Test only two dimensional code
+TEST_F(Poisson2DTester, TestQuadraticDirectSolver)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "  set Number of refinement cycles             = 1" << std::endl
+      << "  set Direct solver dofs threshold            = 500000" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  // The factorization is kept until the matrix is assembled again.
+  ASSERT_TRUE(direct_solver);
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+
+TEST_F(Poisson2DTester, TestQuadraticHp)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Use hp refinement                       = true" << std::endl
+      << "  set Maximum polynomial degree               = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  ASSERT_EQ(fe_collection.size(), 3u);
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    ASSERT_EQ(cell->get_fe().degree, 2u);
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+
+TEST_F(Poisson2DTester, TestQuadraticHpMixedDegrees)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Use hp refinement                       = true" << std::endl
+      << "  set Maximum polynomial degree               = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+
+  // The mesh has no hanging nodes, but the degrees 2 and 3 meet at x = 1/2
+  ASSERT_FALSE(triangulation.has_hanging_nodes());
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      cell->set_active_fe_index(cell->center()[0] < 0.5 ? 1 : 2);
+  setup_system();
+  assemble_system();
+  solve();
+
+  // Without the constraints between the two degrees the discrete space is
+  // not conforming and x^2 is not reproduced
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+
+TEST_F(Poisson2DTester, TestQuadraticPipelinedCG)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "  set Iterative solver                        = pipelined_cg"
+      << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+#ifdef __linux__
+TEST_F(Poisson2DTester, TestConfigureThreads)
+{
+  cpu_set_t inherited_cpu_set;
+  CPU_ZERO(&inherited_cpu_set);
+  ASSERT_EQ(
+    sched_getaffinity(0, sizeof(inherited_cpu_set), &inherited_cpu_set), 0);
+  const unsigned int n_inherited_cores = CPU_COUNT(&inherited_cpu_set);
+
+  // Without an explicit count a single process uses all inherited cores
+  if (Utilities::MPI::n_mpi_processes(mpi_communicator) == 1)
+    {
+      number_of_threads = -1;
+      pin_threads       = false;
+      configure_threads();
+      ASSERT_EQ(MultithreadInfo::n_threads(), n_inherited_cores);
+    }
+
+  // A pinned process only runs on cores it inherited
+  number_of_threads = 1;
+  pin_threads       = true;
+  configure_threads();
+  ASSERT_EQ(MultithreadInfo::n_threads(), 1u);
+
+  cpu_set_t pinned_cpu_set;
+  CPU_ZERO(&pinned_cpu_set);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(pinned_cpu_set), &pinned_cpu_set), 0);
+  ASSERT_EQ(CPU_COUNT(&pinned_cpu_set), 1);
+  cpu_set_t intersection;
+  CPU_AND(&intersection, &pinned_cpu_set, &inherited_cpu_set);
+  ASSERT_TRUE(CPU_EQUAL(&intersection, &pinned_cpu_set));
+
+  // Leave the other tests with the inherited layout
+  ASSERT_EQ(
+    sched_setaffinity(0, sizeof(inherited_cpu_set), &inherited_cpu_set), 0);
+  MultithreadInfo::set_thread_limit();
+}
+#endif
+
+
+TEST_F(Poisson2DTester, TestCuthillMcKeeReducesBandwidth)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set DoF renumbering                         = none" << std::endl
+      << "  set Finite element space                    = FE_Q(1)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 5" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  const auto natural_bandwidth = matrix_bandwidth();
+
+  // Whatever the numbering, the couplings of the 31x31 interior vertices
+  // give a bandwidth of at least 31
+  ASSERT_GE(natural_bandwidth, 31u);
+
+  dof_renumbering = "cuthill_mckee";
+  setup_system();
+  const auto cuthill_mckee_bandwidth = matrix_bandwidth();
+  ASSERT_GE(cuthill_mckee_bandwidth, 31u);
+  ASSERT_LT(cuthill_mckee_bandwidth, natural_bandwidth);
+
+  // The numbering does not change the solution
+  assemble_system();
+  solve();
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+  tmp -= solution;
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+#ifdef DEBUG
+TEST_F(Poisson2DTester, TestAssemblyAllocations)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary ids                  = " << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Neumann boundary ids                    = 0" << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+
+  // With a single thread every cell is assembled with the scratch data that
+  // the first assembly put into the pool, and creates the face values for.
+  // Later assemblies must not allocate.
+  MultithreadInfo::set_thread_limit(1);
+  thread_local_allocation_counter = &count_thread_local_allocations;
+
+  assemble_system();
+  n_assembly_allocations = 0;
+  assemble_system();
+  const std::size_t n_allocations = n_assembly_allocations;
+
+  thread_local_allocation_counter = nullptr;
+  MultithreadInfo::set_thread_limit();
+
+  ASSERT_EQ(n_allocations, 0u);
+}
+#endif
+
+
+TEST_F(Poisson2DTester, TestQuadraticBatchedAssembly)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Batched assembly                        = true" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+TEST_F(Poisson2DTester, TestQuadraticNativeBackend)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Linear algebra backend                  = native" << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+TEST_F(Poisson2DTester, TestNativeBackendAgainstTrilinos)
+{
+  // The native backend is meant for single process runs
+  if (Utilities::MPI::n_mpi_processes(mpi_communicator) > 1)
+    GTEST_SKIP();
+
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Linear algebra backend                  = trilinos"
+      << std::endl
+      << "  set Number of global refinements            = 5" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+
+  // Time assembly and solve with both backends on the same mesh. The times
+  // are recorded as test properties, e.g. in the XML output of the test.
+  const auto assemble_and_solve = [&]() {
+    setup_system();
+    Timer timer;
+    assemble_system();
+    solve();
+    timer.stop();
+
+    auto tmp = solution;
+    VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+    tmp -= solution;
+    EXPECT_NEAR(tmp.l2_norm(), 0, 1e-8);
+    return timer.wall_time();
+  };
+
+  const double trilinos_time = assemble_and_solve();
+  linear_algebra_backend     = "native";
+  const double native_time   = assemble_and_solve();
+
+  RecordProperty("n_dofs", std::to_string(dof_handler.n_dofs()));
+  RecordProperty("trilinos_assemble_and_solve_seconds",
+                 std::to_string(trilinos_time));
+  RecordProperty("native_assemble_and_solve_seconds",
+                 std::to_string(native_time));
+}
+
+TEST_F(Poisson2DTester, TestQuadraticDG)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_DGQ(2)"
+      << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  // SIPG is consistent, so a quadratic solution is reproduced exactly
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler, dirichlet_boundary_condition, tmp);
+
+  tmp -= solution;
+
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-8);
+}
+
+TEST_F(Poisson2DTester, TestMixedElementIsNotDG)
+{
+  // A Stokes element has a discontinuous pressure but a continuous
+  // velocity, which still needs strongly imposed Dirichlet conditions
+  fe = FETools::get_fe_by_name<2>("FESystem[FE_Q(2)^2-FE_DGP(1)]");
+  ASSERT_FALSE(is_dg());
+
+  fe = FETools::get_fe_by_name<2>("FESystem[FE_DGQ(1)^2-FE_DGP(1)]");
+  ASSERT_TRUE(is_dg());
+}
+
+TEST_F(Poisson2DTester, TestGoalFunctional)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Coefficient expression                  = 1 + x" << std::endl
+      << "  set Estimator type                          = dwr" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2 - 4*x" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  subsection Goal functional" << std::endl
+      << "    set Evaluation point = 0.3, 0.7" << std::endl
+      << "  end" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  // The quadratic solution is exact, so is its point value
+  LA::MPI::Vector dual_rhs(locally_owned_dofs, mpi_communicator);
+  const auto      functional =
+    assemble_goal_functional(dof_handler,
+                             locally_relevant_solution,
+                             dual_rhs,
+                             constraints);
+  ASSERT_NEAR(functional.first, 0.09, 1e-10);
+  ASSERT_NEAR(functional.second, 0.09, 1e-10);
+
+  // The dual problem is solved in FE_Q(3), so z - I_h z does not vanish
+  estimate();
+  ASSERT_EQ(dual_dof_handler.get_fe().degree, 3u);
+  ASSERT_GT(locally_relevant_dual_solution.l2_norm(), 0);
+  ASSERT_GT(dual_weights.l1_norm(), 0);
+
+  // The strong residual f + div((1 + x) grad u_h) vanishes only if the
+  // coefficient is taken into account, and so does the sum of all eta_K
+  ASSERT_NEAR(latest_errors.at("estimator"), 0, 1e-8);
+}
+
+TEST_F(Poisson2DTester, TestLOBPCG)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = 0" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = 0" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 4" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+
+  LA::MPI::SparseMatrix mass_matrix;
+  mass_matrix.reinit(system_matrix);
+  MatrixCreator::create_mass_matrix(
+    *mapping, dof_handler, QGauss<2>(3), mass_matrix, nullptr, constraints);
+
+  LA::MPI::PreconditionAMG amg;
+  amg.initialize(system_matrix);
+
+  std::vector<LA::MPI::Vector> modes(2, solution);
+  for (const auto i : locally_owned_dofs)
+    {
+      modes[0][i] = 1;
+      modes[1][i] = static_cast<double>(i % 7) - 3;
+    }
+  for (auto &mode : modes)
+    mode.compress(VectorOperation::insert);
+
+  SolverControl                 control(200, 1e-8);
+  SolverLOBPCG<LA::MPI::Vector> solver(control);
+  std::vector<double>           eigenvalues;
+  solver.solve(system_matrix,
+               mass_matrix,
+               amg,
+               eigenvalues,
+               modes,
+               [&](LA::MPI::Vector &v) { constraints.set_zero(v); });
+
+  // The lowest eigenvalues of the Dirichlet Laplacian on the unit square
+  const double pi2 = numbers::PI * numbers::PI;
+  ASSERT_NEAR(eigenvalues[0] / (2 * pi2), 1, 1e-3);
+  ASSERT_NEAR(eigenvalues[1] / (5 * pi2), 1, 1e-3);
+}
+
+TEST_F(Poisson2DTester, TestLOBPCGOrthonormalize)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+
+  std::vector<LA::MPI::Vector> vectors(3, solution);
+  for (const auto i : locally_owned_dofs)
+    {
+      vectors[0][i] = 1;
+      vectors[1][i] = static_cast<double>(i % 7) - 3;
+      vectors[2][i] = static_cast<double>(i % 5);
+    }
+  for (auto &v : vectors)
+    v.compress(VectorOperation::insert);
+
+  // With B = A = I the basis is its own image
+  auto A_vectors = vectors;
+  auto B_vectors = vectors;
+  auto pointers  = [](std::vector<LA::MPI::Vector> &v) {
+    std::vector<LA::MPI::Vector *> p;
+    for (auto &x : v)
+      p.push_back(&x);
+    return p;
+  };
+
+  using Solver = SolverLOBPCG<LA::MPI::Vector>;
+  ASSERT_TRUE(Solver::orthonormalize(
+    pointers(vectors), pointers(A_vectors), pointers(B_vectors), 1e-10));
+  for (unsigned int i = 0; i < 3; ++i)
+    for (unsigned int j = 0; j < 3; ++j)
+      ASSERT_NEAR(vectors[i] * B_vectors[j], i == j ? 1. : 0., 1e-12);
+
+  // A nearly dependent vector is rejected and nothing is changed
+  vectors[2] = vectors[0];
+  vectors[2].add(1e-8, vectors[1]);
+  A_vectors = vectors;
+  B_vectors = vectors;
+  const auto copy = vectors;
+  ASSERT_FALSE(Solver::orthonormalize(
+    pointers(vectors), pointers(A_vectors), pointers(B_vectors), 1e-10));
+  for (unsigned int i = 0; i < 3; ++i)
+    {
+      auto difference = vectors[i];
+      difference -= copy[i];
+      ASSERT_EQ(difference.l2_norm(), 0);
+    }
+}
+
+TEST_F(Poisson2DTester, TestCubicCachedMappingOnCurvedMesh)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Cache mapping                           = true" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0,0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_ball"
+      << std::endl
+      << "  set Mapping degree                          = 3" << std::endl
+      << "  set Number of global refinements            = 1" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  ASSERT_TRUE(mapping_cache_is_current);
+
+  // Refining the mesh must invalidate the cache, and the next setup must
+  // rebuild it for the new cells
+  for (const auto &cell : triangulation.active_cell_iterators())
+    cell->set_refine_flag();
+  refine_grid();
+  ASSERT_FALSE(mapping_cache_is_current);
+  setup_system();
+  ASSERT_TRUE(mapping_cache_is_current);
+
+  // The cached support points follow the curved boundary exactly like the
+  // mapping they were computed from
+  const MappingQGeneric<2> reference(mapping_degree);
+  const QGauss<2>          quadrature(mapping_degree + 1);
+  FEValues<2> cached_values(*mapping, *fe, quadrature, update_JxW_values);
+  FEValues<2> reference_values(reference, *fe, quadrature, update_JxW_values);
+
+  double area = 0;
+  for (const auto &cell : triangulation.active_cell_iterators())
+    if (cell->is_locally_owned())
+      {
+        const Point<2> center(0.5, 0.5);
+        ASSERT_LT(mapping->transform_unit_to_real_cell(cell, center).distance(
+                    reference.transform_unit_to_real_cell(cell, center)),
+                  1e-12);
+
+        cached_values.reinit(cell);
+        reference_values.reinit(cell);
+        double cached_measure    = 0;
+        double reference_measure = 0;
+        for (const auto q : cached_values.quadrature_point_indices())
+          {
+            cached_measure += cached_values.JxW(q);
+            reference_measure += reference_values.JxW(q);
+          }
+        ASSERT_NEAR(cached_measure, reference_measure, 1e-12);
+        area += cached_measure;
+      }
+
+  area = Utilities::MPI::sum(area, mpi_communicator);
+  ASSERT_NEAR(area, numbers::PI, 1e-3);
+}
+
+TEST_F(Poisson2DTester, TestMeshCache)
+{
+  // All processes must agree on the cache directory
+  const auto directory =
+    std::filesystem::temp_directory_path() /
+    ("mesh_cache_" +
+     std::to_string(Utilities::MPI::broadcast(mpi_communicator, ::getpid())));
+  std::filesystem::create_directories(directory);
+
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Mesh cache directory                    = "
+      << directory.string() << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  const auto n_cells = triangulation.n_global_active_cells();
+  ASSERT_EQ(n_cells, 64u);
+
+  const auto cache_filename = mesh_cache_filename(mesh_cache_key());
+  ASSERT_TRUE(std::filesystem::exists(cache_filename + ".info"));
+  ASSERT_TRUE(std::filesystem::exists(cache_filename + ".key"));
+
+  // A miss rewrites the key file and would drop this marker, a hit keeps it
+  MPI_Barrier(mpi_communicator);
+  if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+    std::ofstream(cache_filename + ".key", std::ios::app) << "loaded"
+                                                          << std::endl;
+  MPI_Barrier(mpi_communicator);
+
+  triangulation.clear();
+  make_grid();
+  ASSERT_EQ(triangulation.n_global_active_cells(), n_cells);
+  {
+    std::ifstream key_file(cache_filename + ".key");
+    std::string   key, marker;
+    std::getline(key_file, key);
+    std::getline(key_file, marker);
+    ASSERT_EQ(key, mesh_cache_key());
+    ASSERT_EQ(marker, "loaded");
+  }
+
+  // A different refinement changes the key and misses the cache
+  n_refinements = 4;
+  ASSERT_NE(mesh_cache_filename(mesh_cache_key()), cache_filename);
+  triangulation.clear();
+  make_grid();
+  ASSERT_EQ(triangulation.n_global_active_cells(), 256u);
+  ASSERT_TRUE(std::filesystem::exists(
+    mesh_cache_filename(mesh_cache_key()) + ".info"));
+
+  MPI_Barrier(mpi_communicator);
+  if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+    std::filesystem::remove_all(directory);
+}
+
+TEST_F(Poisson2DTester, TestDiagnostics)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0,1,2,3" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: true"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+
+  probe_points          = {Point<2>(0.3, 0.7)};
+  boundary_integral_ids = {1, 2};
+  diagnostics_filename =
+    (std::filesystem::temp_directory_path() /
+     ("diagnostics_" +
+      std::to_string(Utilities::MPI::broadcast(mpi_communicator, ::getpid()))))
+      .string();
+
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+  diagnostics(0);
+
+  // The points are located once per mesh
+  ASSERT_TRUE(diagnostic_evaluation_is_current);
+  const auto *evaluation = diagnostic_evaluation.get();
+  diagnostics(0);
+  ASSERT_EQ(diagnostic_evaluation.get(), evaluation);
+
+  // The solution is x^2: its value at the probe is 0.09, its integral over
+  // the side x = 1 (id 1) is 1 and over the side y = 0 (id 2) is 1/3
+  if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+    {
+      const auto    filename = diagnostics_filename + "_0.csv";
+      std::ifstream csv(filename);
+      std::string   line;
+      std::getline(csv, line);
+      ASSERT_EQ(line, "kind,index,x,y,u0,measure");
+
+      std::getline(csv, line);
+      auto columns = Utilities::split_string_list(line, ',');
+      ASSERT_EQ(columns[0], "probe");
+      ASSERT_NEAR(Utilities::string_to_double(columns[4]), 0.09, 1e-10);
+
+      const std::vector<double> expected_integrals = {1., 1. / 3.};
+      for (const auto expected : expected_integrals)
+        {
+          std::getline(csv, line);
+          columns = Utilities::split_string_list(line, ',');
+          ASSERT_EQ(columns[0], "boundary");
+          ASSERT_NEAR(Utilities::string_to_double(columns[4]), expected, 1e-10);
+          ASSERT_NEAR(Utilities::string_to_double(columns[5]), 1, 1e-10);
+        }
+      std::filesystem::remove(filename);
+    }
+
+  // Refining the mesh invalidates the located points
+  triangulation.refine_global(1);
+  ASSERT_FALSE(diagnostic_evaluation_is_current);
+}
+
+TEST_F(Poisson2DTester, TestErrorTableNorms)
+{
+  std::stringstream str;
+
+  // The Error table section of older parameter files still lists the norms
+  str << "subsection Error table" << std::endl
+      << "  set List of error norms to compute = L2_norm, Linfty_norm, H1_norm"
+      << std::endl
+      << "end" << std::endl
+      << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Error norms                             = L2_norm" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Forcing term expression                 = -2" << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Number of refinement cycles             = 1" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+
+  // The norms are moved to "Error norms" and the table computes none itself
+  const std::set<VectorTools::NormType> expected_norms = {
+    VectorTools::L2_norm, VectorTools::Linfty_norm, VectorTools::H1_norm};
+  ASSERT_EQ(error_norms, expected_norms);
+  ParameterAcceptor::prm.enter_subsection("Error table");
+  ASSERT_EQ(ParameterAcceptor::prm.get("List of error norms to compute"),
+            default_error_table_norms);
+  ParameterAcceptor::prm.leave_subsection();
+
+  run();
+  ASSERT_NEAR(latest_errors.at("u_L2_norm"), 0, 1e-10);
+  ASSERT_NEAR(latest_errors.at("u_Linfty_norm"), 0, 1e-10);
+  ASSERT_NEAR(latest_errors.at("u_H1_norm"), 0, 1e-10);
+}
+
+TEST_F(Poisson2DTester, TestLoadCases)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0,1" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Grid generator arguments                = 0: 1: true"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Load case forcing term expressions      = -2 | 0" << std::endl
+      << "  set Neumann boundary condition expression   = 0" << std::endl
+      << "  set Neumann boundary ids                    = 2,3" << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  set_load_case(0);
+  assemble_system();
+  solve_load_cases(0);
+
+  // Both load cases share the lift of the boundary values x^2. The first one
+  // reproduces x^2, the second one is solved by x, whose L2 distance to the
+  // exact solution x^2 is sqrt(1/30).
+  ASSERT_EQ(load_case_errors.size(), 2u);
+  ASSERT_NEAR(load_case_errors[0].at("u_L2_norm"), 0, 1e-10);
+  ASSERT_NEAR(load_case_errors[1].at("u_L2_norm"), std::sqrt(1. / 30.), 1e-8);
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler,
+                           ScalarFunctionFromFunctionObject<2>(
+                             [](const Point<2> &p) { return p[0]; }),
+                           tmp);
+  tmp -= solution;
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+TEST_F(Poisson2DTester, TestEnsembleReusesSystem)
+{
+  std::stringstream str;
+
+  str << "subsection Poisson<2>" << std::endl
+      << "  set Dirichlet boundary condition expression = x^2" << std::endl
+      << "  set Dirichlet boundary ids                  = 0,1" << std::endl
+      << "  set Exact solution expression               = x^2" << std::endl
+      << "  set Finite element space                    = FE_Q(2)" << std::endl
+      << "  set Grid generator arguments                = 0: 1: true"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Neumann boundary condition expression   = 0" << std::endl
+      << "  set Neumann boundary ids                    = 2,3" << std::endl
+      << "  set Number of global refinements            = 3" << std::endl
+      << "  set Number of refinement cycles             = 1" << std::endl
+      << "  set Output format                           = none" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+
+  // Every process writes and reads its own copy of the sweep file
+  const auto sweep_filename =
+    (std::filesystem::temp_directory_path() /
+     ("ensemble_sweep_" + std::to_string(::getpid()) + ".txt"))
+      .string();
+  {
+    std::ofstream sweep(sweep_filename);
+    sweep << "Poisson<2>/Forcing term expression = -2 | 0" << std::endl;
+  }
+  run_ensemble(sweep_filename);
+  std::filesystem::remove(sweep_filename);
+
+  // The second run only changes the forcing term, so it keeps the matrix and
+  // the lift of the boundary values x^2 from the first run. Its solution is
+  // x, whose L2 distance to x^2 is sqrt(1/30).
+  ASSERT_TRUE(reuse_system);
+  ASSERT_NEAR(latest_errors.at("u_L2_norm"), std::sqrt(1. / 30.), 1e-8);
+
+  auto tmp = solution;
+  VectorTools::interpolate(dof_handler,
+                           ScalarFunctionFromFunctionObject<2>(
+                             [](const Point<2> &p) { return p[0]; }),
+                           tmp);
+  tmp -= solution;
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
 // Test only two dimensional code
 TEST_F(Poisson2DTester, TestMixedBC1)
 {
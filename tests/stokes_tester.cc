@@ -0,0 +1,153 @@
+#include "stokes_tester.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace dealii;
+
+using Stokes2DTester = StokesTester<std::integral_constant<int, 2>>;
+
+
+namespace
+{
+  // Stokes with the default coupling of all blocks, to compare against the
+  // reduced sparsity pattern
+  class FullyCoupledStokes : public Stokes<2>
+  {
+  public:
+    std::pair<LA::MPI::BlockVector, std::size_t>
+    solve_fully_coupled()
+    {
+      make_grid();
+      setup_system();
+      assemble_system();
+      solve();
+      return {block_solution, system_block_matrix.n_nonzero_elements()};
+    }
+
+  protected:
+    virtual Table<2, DoFTools::Coupling>
+    coupling_table() const override
+    {
+      return BaseBlockProblem<2>::coupling_table();
+    }
+  };
+
+  // The Q2-Q1 pair reproduces the quadratic velocity (y^2, x^2) and the
+  // linear pressure exactly. The pressure is fixed by its boundary values.
+  std::string
+  linear_pressure_parameters()
+  {
+    std::stringstream str;
+    str << "subsection Stokes<2>" << std::endl
+        << "  set Dirichlet boundary condition expression = "
+        << "y^2; x^2; 3*x+2*y-2.5" << std::endl
+        << "  set Dirichlet boundary ids                  = 0" << std::endl
+        << "  set Exact solution expression               = "
+        << "y^2; x^2; 3*x+2*y-2.5" << std::endl
+        << "  set Finite element space = FESystem[FE_Q(2)^2-FE_Q(1)]"
+        << std::endl
+        << "  set Forcing term expression                 = 2; 1; 0"
+        << std::endl
+        << "  set Grid generator arguments                = 0: 1: false"
+        << std::endl
+        << "  set Grid generator function                 = hyper_cube"
+        << std::endl
+        << "  set Number of global refinements            = 1" << std::endl
+        << "end" << std::endl;
+    return str.str();
+  }
+} // namespace
+
+
+TEST_F(Stokes2DTester, TestPressureBlockIsEmpty)
+{
+  parse_string(linear_pressure_parameters());
+  make_grid();
+  setup_system();
+
+  // Only the diagonal entries of constrained pressure dofs are stored in the
+  // pressure-pressure block
+  const auto &pressure_block = system_block_matrix.block(1, 1);
+  for (const auto row : locally_owned_dofs[1])
+    for (auto entry = pressure_block.begin(row);
+         entry != pressure_block.end(row);
+         ++entry)
+      {
+        ASSERT_EQ(entry->column(), row);
+        ASSERT_TRUE(constraints.is_constrained(dofs_per_block[0] + row));
+      }
+
+  assemble_system();
+  solve();
+
+  // The same problem with all blocks coupled has more entries and the same
+  // solution
+  FullyCoupledStokes fully_coupled;
+  fully_coupled.parse_string(linear_pressure_parameters());
+  const auto [fully_coupled_solution, fully_coupled_nonzeros] =
+    fully_coupled.solve_fully_coupled();
+  ASSERT_LT(system_block_matrix.n_nonzero_elements(), fully_coupled_nonzeros);
+
+  auto difference = block_solution;
+  difference -= fully_coupled_solution;
+  ASSERT_NEAR(difference.l2_norm(), 0, 1e-10);
+}
+
+
+
+TEST_F(Stokes2DTester, TestManufacturedSolution)
+{
+  // -div(eps(u)) + grad(p) = f with u = (y^2, x^2) and p = 3x + 2y - 2.5
+  parse_string(linear_pressure_parameters());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  auto tmp = block_solution;
+  VectorTools::interpolate(*mapping, dof_handler, exact_solution, tmp);
+  tmp -= block_solution;
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}
+
+
+
+using Stokes3DTester = StokesTester<std::integral_constant<int, 3>>;
+
+
+TEST_F(Stokes3DTester, TestManufacturedSolution)
+{
+  std::stringstream str;
+
+  // -div(eps(u)) + grad(p) = f with u = (y^2, z^2, x^2) and
+  // p = 3x + 2y + z - 3
+  str << "subsection Stokes<3>" << std::endl
+      << "  set Dirichlet boundary condition expression = "
+      << "y^2; z^2; x^2; 3*x+2*y+z-3" << std::endl
+      << "  set Dirichlet boundary ids                  = 0" << std::endl
+      << "  set Exact solution expression               = "
+      << "y^2; z^2; x^2; 3*x+2*y+z-3" << std::endl
+      << "  set Finite element space = FESystem[FE_Q(2)^3-FE_Q(1)]"
+      << std::endl
+      << "  set Forcing term expression                 = 2; 1; 0; 0"
+      << std::endl
+      << "  set Grid generator arguments                = 0: 1: false"
+      << std::endl
+      << "  set Grid generator function                 = hyper_cube"
+      << std::endl
+      << "  set Number of global refinements            = 0" << std::endl
+      << "end" << std::endl;
+
+  parse_string(str.str());
+  make_grid();
+  setup_system();
+  assemble_system();
+  solve();
+
+  auto tmp = block_solution;
+  VectorTools::interpolate(*mapping, dof_handler, exact_solution, tmp);
+  tmp -= block_solution;
+  ASSERT_NEAR(tmp.l2_norm(), 0, 1e-10);
+}